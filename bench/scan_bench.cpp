@@ -0,0 +1,117 @@
+// Throughput of the byte scanning kernels used by io::LineReader::next_line
+// and io::no_quote_escape on tubesheet.csv shaped data.
+//
+// Build from the repository root with
+//     g++ -std=c++17 -O2 -Iinc bench/scan_bench.cpp -o scan_bench -lpthread
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "csv.h"
+
+namespace {
+
+const int row_count = 1 << 20;
+const int repetitions = 5;
+
+std::string make_tubesheet() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(0, 72);
+    std::string data = "x_label;y_label;cl_x;cl_y;hl_x;hl_y;tube_id\r\n";
+    char line[128];
+    for (int i = 0; i < row_count; ++i) {
+        std::snprintf(line, sizeof(line), "%d;%d;%.3f;%.3f;%.3f;%.3f;TUBE.%d\r\n",
+                2 + 2 * (i % 87), 1 + i / 87, coord(rng), coord(rng), coord(rng),
+                coord(rng), i + 1);
+        data += line;
+    }
+    return data;
+}
+
+template<class Fn>
+void report(const char *name, std::size_t bytes, Fn fn) {
+    double best = 1e9;
+    std::size_t found = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        found = fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::printf("%-24s %8.1f MB/s  (%zu hits)\n", name, bytes / best / 1e6, found);
+}
+
+std::size_t count_lines(const std::string &data, io::detail::find_char_func find) {
+    std::size_t lines = 0;
+    const char *end = data.data() + data.size();
+    for (const char *p = data.data(); p != end; ++lines) {
+        p = find(p, end, '\n');
+        if (p != end) {
+            ++p;
+        }
+    }
+    return lines;
+}
+
+// Splits every line into columns the way io::detail::parse_line does
+template<class Finder>
+std::size_t count_columns(const std::vector<const char*> &lines) {
+    std::size_t columns = 0;
+    for (const char *line : lines) {
+        Finder find_column_end;
+        for (const char *p = line;; ++p, ++columns) {
+            p = find_column_end(p);
+            if (*p == '\0') {
+                ++columns;
+                break;
+            }
+        }
+    }
+    return columns;
+}
+
+struct scalar_finder {
+    const char *operator()(const char *col_begin) {
+        return io::no_quote_escape<';'>::find_next_column_end(col_begin);
+    }
+};
+
+}
+
+int main() {
+    std::string data = make_tubesheet();
+
+    // Columns are scanned within NUL terminated lines, as LineReader hands them out
+    std::string terminated = data;
+    std::vector<const char*> lines;
+    for (std::size_t i = 0, begin = 0; i < terminated.size(); ++i) {
+        if (terminated[i] == '\n') {
+            terminated[i] = '\0';
+            terminated[i - 1] = '\0';
+            lines.push_back(&terminated[begin]);
+            begin = i + 1;
+        }
+    }
+
+    std::printf("%zu bytes of tubesheet.csv shaped data\n\n", data.size());
+
+    std::printf("line ends (next_line)\n");
+    report("scalar", data.size(), [&] { return count_lines(data, io::detail::find_char_scalar); });
+#ifdef CSV_IO_HAS_SIMD
+    report("sse2", data.size(), [&] { return count_lines(data, io::detail::find_char_sse2); });
+    if (__builtin_cpu_supports("avx2")) {
+        report("avx2", data.size(), [&] { return count_lines(data, io::detail::find_char_avx2); });
+    }
+#endif
+    report("dispatched", data.size(), [&] { return count_lines(data, io::detail::find_char); });
+
+    std::printf("\nseparators (chop_next_column)\n");
+    report("scalar", data.size(), [&] { return count_columns<scalar_finder>(lines); });
+    report("dispatched", data.size(), [&] {
+        return count_columns<io::detail::column_end_finder<io::no_quote_escape<';'>>>(lines);
+    });
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Printing a tubesheet shaped rapidxml document: the stream printer behind
+// operator<<, which writes every character through an ostream_iterator,
+// against print_buffered, which fills a contiguous buffer and writes it once.
+//
+// Build from the repository root with
+//     g++ -std=c++17 -O2 -Iinc bench/xml_print_bench.cpp -o xml_print_bench
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "rapidxml-1.13/rapidxml.hpp"
+#include "rapidxml-1.13/rapidxml_print.hpp"
+
+namespace {
+
+const int tube_count = 1 << 16;
+const int repetitions = 5;
+
+typedef rapidxml::xml_document<char> document;
+typedef rapidxml::xml_node<char> node;
+
+char* pool_copy(document &doc, const char *text) {
+    return doc.allocate_string(text);
+}
+
+void add_attribute(document &doc, node *element, const char *name,
+        const char *value, bool safe) {
+    auto attribute = doc.allocate_attribute(name, pool_copy(doc, value));
+    attribute->value_safe(safe);
+    element->append_attribute(attribute);
+}
+
+// A group with title, circle and number per tube, like the groups mode of
+// tubesheet_svg. With mark_safe the numeric values are marked as needing no
+// expansion, as svg_dom_writer does.
+void make_tubesheet(document &doc, bool mark_safe) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(0, 72);
+    node *svg = doc.allocate_node(rapidxml::node_element, "svg");
+    doc.append_node(svg);
+    add_attribute(doc, svg, "viewBox", "-1 -73 74 147", false);
+    add_attribute(doc, svg, "xmlns", "http://www.w3.org/2000/svg", false);
+    char text[64];
+    for (int i = 0; i < tube_count; ++i) {
+        node *g = doc.allocate_node(rapidxml::node_element, "g");
+        svg->append_node(g);
+        int col = 2 + 2 * (i % 87);
+        int row = 1 + i / 87;
+        std::snprintf(text, sizeof(text), "%d", col);
+        add_attribute(doc, g, "data-col", text, mark_safe);
+        std::snprintf(text, sizeof(text), "%d", row);
+        add_attribute(doc, g, "data-row", text, mark_safe);
+        std::snprintf(text, sizeof(text), "hl%d", i + 1);
+        add_attribute(doc, g, "id", text, false);
+
+        std::snprintf(text, sizeof(text), "Col=%d Row=%d", col, row);
+        g->append_node(doc.allocate_node(rapidxml::node_element, "title",
+                pool_copy(doc, text)));
+
+        char x[32];
+        char y[32];
+        std::snprintf(x, sizeof(x), "%.3f", coord(rng));
+        std::snprintf(y, sizeof(y), "%.3f", coord(rng));
+        node *circle = doc.allocate_node(rapidxml::node_element, "circle");
+        g->append_node(circle);
+        add_attribute(doc, circle, "class", "tube", false);
+        add_attribute(doc, circle, "cx", x, mark_safe);
+        add_attribute(doc, circle, "cy", y, mark_safe);
+        add_attribute(doc, circle, "r", "0.3125", mark_safe);
+
+        std::snprintf(text, sizeof(text), "%d", i + 1);
+        node *number = doc.allocate_node(rapidxml::node_element, "text",
+                pool_copy(doc, text));
+        number->value_safe(mark_safe);
+        g->append_node(number);
+        add_attribute(doc, number, "class", "tube_num", false);
+        add_attribute(doc, number, "x", x, mark_safe);
+        add_attribute(doc, number, "y", y, mark_safe);
+    }
+}
+
+template<class Fn>
+void report(const char *name, std::size_t bytes, Fn fn) {
+    double best = 1e9;
+    for (int i = 0; i < repetitions; ++i) {
+        std::ofstream out("/dev/null");
+        auto start = std::chrono::steady_clock::now();
+        fn(out);
+        out.flush();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::printf("%-28s %8.2f ms %8.1f MB/s\n", name, best * 1e3, bytes / best / 1e6);
+}
+
+}
+
+int main() {
+    document plain;
+    make_tubesheet(plain, false);
+    document marked;
+    make_tubesheet(marked, true);
+
+    std::ostringstream expected;
+    expected << plain;
+    std::ostringstream buffered;
+    rapidxml::print_buffered(buffered, marked);
+    if (buffered.str() != expected.str()) {
+        std::printf("print_buffered output differs from operator<<\n");
+        return 1;
+    }
+    std::size_t bytes = expected.str().size();
+    std::printf("%d tubes, %zu bytes of SVG\n\n", tube_count, bytes);
+
+    report("operator<<", bytes, [&](std::ostream &out) { out << plain; });
+    report("print_buffered", bytes, [&](std::ostream &out) {
+        rapidxml::print_buffered(out, plain);
+    });
+    // A reused buffer skips the growth of the first print, which leaves the
+    // copying and the expansion of the values
+    rapidxml::print_buffer<char> buffer;
+    report("reused print_buffer", bytes, [&](std::ostream &out) {
+        buffer.clear();
+        rapidxml::print(buffer, plain);
+        out.write(buffer.data(), buffer.size());
+    });
+    report("reused, safe numbers", bytes, [&](std::ostream &out) {
+        buffer.clear();
+        rapidxml::print(buffer, marked);
+        out.write(buffer.data(), buffer.size());
+    });
+
+    return 0;
+}
@@ -49,6 +49,31 @@
 #include <cerrno>
 #include <istream>
 #include <limits>
+#include <cstdint>
+#include <cfloat>
+#if !defined(CSV_IO_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define CSV_IO_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#if __cplusplus >= 201703L
+#include <string_view>
+#define CSV_IO_HAS_STRING_VIEW
+#endif
+#if !defined(CSV_IO_NO_FROM_CHARS) && defined(__cpp_lib_to_chars)
+#define CSV_IO_HAS_FROM_CHARS
+#endif
+#if !defined(CSV_IO_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define CSV_IO_HAS_SIMD
+#include <immintrin.h>
+#endif
 
 namespace io{
         ////////////////////////////////////////////////////////////////////////////
@@ -140,12 +165,178 @@ namespace io{
                 };
         }
 
+        namespace detail{
+                // Returns the first occurrence of c in [begin, end) or end.
+                inline const char*find_char_scalar(const char*begin, const char*end, char c){
+                        while(begin != end && *begin != c)
+                                ++begin;
+                        return begin;
+                }
+
+                #ifdef CSV_IO_HAS_SIMD
+                inline const char*find_char_sse2(const char*begin, const char*end, char c){
+                        const __m128i needle = _mm_set1_epi8(c);
+                        for(; end - begin >= 16; begin += 16){
+                                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+                                if(mask != 0)
+                                        return begin + __builtin_ctz(mask);
+                        }
+                        return find_char_scalar(begin, end, c);
+                }
+
+                // Bit i of the result is set if block[i] is c or '\0'. All 64 bytes
+                // of the block have to be readable, it may be unaligned.
+                inline std::uint64_t char_or_nul_mask_sse2(const char*block, char c){
+                        const __m128i needle = _mm_set1_epi8(c);
+                        const __m128i zero = _mm_setzero_si128();
+                        std::uint64_t mask = 0;
+                        for(int i=0; i<4; ++i){
+                                __m128i part = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16*i));
+                                std::uint64_t part_mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(part, needle), _mm_cmpeq_epi8(part, zero)));
+                                mask |= part_mask << (16*i);
+                        }
+                        return mask;
+                }
+
+                __attribute__((target("avx2")))
+                inline const char*find_char_avx2(const char*begin, const char*end, char c){
+                        const __m256i needle = _mm256_set1_epi8(c);
+                        for(; end - begin >= 32; begin += 32){
+                                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+                                unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+                                if(mask != 0)
+                                        return begin + __builtin_ctz(mask);
+                        }
+                        return find_char_sse2(begin, end, c);
+                }
+
+                __attribute__((target("avx2")))
+                inline std::uint64_t char_or_nul_mask_avx2(const char*block, char c){
+                        const __m256i needle = _mm256_set1_epi8(c);
+                        const __m256i zero = _mm256_setzero_si256();
+                        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+                        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+                        std::uint64_t low_mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(low, needle), _mm256_cmpeq_epi8(low, zero))));
+                        std::uint64_t high_mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(high, needle), _mm256_cmpeq_epi8(high, zero))));
+                        return low_mask | high_mask << 32;
+                }
+                #endif
+
+                typedef const char*(*find_char_func)(const char*, const char*, char);
+                typedef std::uint64_t(*char_or_nul_mask_func)(const char*, char);
+
+                inline find_char_func select_find_char(){
+                        #ifdef CSV_IO_HAS_SIMD
+                        __builtin_cpu_init();
+                        if(__builtin_cpu_supports("avx2"))
+                                return find_char_avx2;
+                        return find_char_sse2;
+                        #else
+                        return find_char_scalar;
+                        #endif
+                }
+
+                #ifdef CSV_IO_HAS_SIMD
+                inline char_or_nul_mask_func select_char_or_nul_mask(){
+                        __builtin_cpu_init();
+                        if(__builtin_cpu_supports("avx2"))
+                                return char_or_nul_mask_avx2;
+                        return char_or_nul_mask_sse2;
+                }
+                #endif
+
+                // The kernels are picked once, based on what the CPU supports.
+                inline const char*find_char(const char*begin, const char*end, char c){
+                        static const find_char_func impl = select_find_char();
+                        return impl(begin, end, c);
+                }
+
+                inline char*find_char(char*begin, char*end, char c){
+                        return begin + (find_char(static_cast<const char*>(begin), end, c) - begin);
+                }
+
+                #ifdef CSV_IO_HAS_SIMD
+                inline std::uint64_t char_or_nul_mask(const char*block, char c){
+                        static const char_or_nul_mask_func impl = select_char_or_nul_mask();
+                        return impl(block, c);
+                }
+                #endif
+        }
+
         class ByteSourceBase{
         public:
                 virtual int read(char*buffer, int size)=0;
                 virtual ~ByteSourceBase(){}
         };
 
+        #ifdef CSV_IO_HAS_MMAP
+        // A private, writable mapping of a regular file. Lines are handed
+        // out straight from the mapped pages and terminated in place, so
+        // the writes only ever touch our copy-on-write pages.
+        class MappedFile{
+        public:
+                MappedFile(char*data, std::size_t size):data(data), size(size){}
+                MappedFile(const MappedFile&) = delete;
+                MappedFile&operator=(const MappedFile&) = delete;
+
+                char*begin()const{
+                        return data;
+                }
+
+                char*end()const{
+                        return data + size;
+                }
+
+                ~MappedFile(){
+                        munmap(data, size);
+                }
+
+                // Returns nullptr if fd does not refer to something that can be
+                // mapped, in which case the caller should fall back to reading.
+                static std::unique_ptr<MappedFile> map(int fd){
+                        struct stat st;
+                        if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+                                return nullptr;
+                        std::size_t size = st.st_size;
+                        void*data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                        if(data == MAP_FAILED)
+                                return nullptr;
+                        std::unique_ptr<MappedFile>file(new MappedFile(static_cast<char*>(data), size));
+
+                        // The last line is terminated by writing one byte past its end.
+                        // That byte is in the zero filled tail of the last page unless
+                        // the file size is a multiple of the page size.
+                        long page_size = sysconf(_SC_PAGESIZE);
+                        if(page_size > 0 && size % page_size == 0 && file->end()[-1] != '\n')
+                                return nullptr;
+
+                        madvise(data, size, MADV_SEQUENTIAL);
+                        return file;
+                }
+
+                // Maps the named file. Throws if it can not be opened and returns
+                // nullptr if it is not a regular file that can be mapped.
+                static std::unique_ptr<MappedFile> open(const char*file_name){
+                        int fd = ::open(file_name, O_RDONLY);
+                        if(fd == -1){
+                                int x = errno;
+                                error::can_not_open_file err;
+                                err.set_errno(x);
+                                err.set_file_name(file_name);
+                                throw err;
+                        }
+                        std::unique_ptr<MappedFile>file = map(fd);
+                        ::close(fd);
+                        return file;
+                }
+
+        private:
+                char*data;
+                std::size_t size;
+        };
+        #endif
+
         namespace detail{
 
                 class OwningStdIOByteSourceBase : public ByteSourceBase{
@@ -318,6 +509,9 @@ namespace io{
                 };
         }
 
+        struct in_place_t{};
+        static const in_place_t in_place = in_place_t();
+
         class LineReader{
         private:
                 static const int block_len = 1<<20;
@@ -330,6 +524,37 @@ namespace io{
                 int data_begin;
                 int data_end;
 
+                #ifdef CSV_IO_HAS_MMAP
+                std::unique_ptr<MappedFile>mapping;
+                #endif
+                // Set if lines are handed out straight from [range_begin, range_end)
+                // instead of being copied through buffer.
+                bool in_place;
+                char*range_begin;
+                char*range_end;
+
+                // While the arena is enabled buffered lines are copied into it, so
+                // that they outlive the buffer.
+                static const std::size_t arena_block_len = 1<<16;
+                bool arena_enabled = false;
+                std::vector<std::unique_ptr<char[]>>arena_blocks;
+                char*arena_pos = nullptr;
+                char*arena_end = nullptr;
+
+                char*copy_to_arena(const char*line){
+                        std::size_t size = std::strlen(line) + 1;
+                        if(static_cast<std::size_t>(arena_end - arena_pos) < size){
+                                std::size_t block_size = size > arena_block_len ? size : arena_block_len;
+                                arena_blocks.emplace_back(new char[block_size]);
+                                arena_pos = arena_blocks.back().get();
+                                arena_end = arena_pos + block_size;
+                        }
+                        char*copy = arena_pos;
+                        std::memcpy(copy, line, size);
+                        arena_pos += size;
+                        return copy;
+                }
+
                 char file_name[error::max_file_name_length+1];
                 unsigned file_line;
 
@@ -347,8 +572,85 @@ namespace io{
                         return std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file));
                 }
 
+                // Regular files are memory mapped, everything else (pipes, character
+                // devices, ...) goes through the buffered fread path.
+                void open_and_init(const char*file_name){
+                        #ifdef CSV_IO_HAS_MMAP
+                        int fd = ::open(file_name, O_RDONLY);
+                        if(fd == -1){
+                                int x = errno;
+                                error::can_not_open_file err;
+                                err.set_errno(x);
+                                err.set_file_name(file_name);
+                                throw err;
+                        }
+                        mapping = MappedFile::map(fd);
+                        if(mapping != nullptr){
+                                ::close(fd);
+                                init_in_place(mapping->begin(), mapping->end());
+                                return;
+                        }
+                        FILE*file = fdopen(fd, "rb");
+                        if(file == 0){
+                                int x = errno;
+                                ::close(fd);
+                                error::can_not_open_file err;
+                                err.set_errno(x);
+                                err.set_file_name(file_name);
+                                throw err;
+                        }
+                        init(std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file)));
+                        #else
+                        init(open_file(file_name));
+                        #endif
+                }
+
+                void init_in_place(char*data_begin, char*data_end){
+                        file_line = 0;
+                        this->data_begin = 0;
+                        this->data_end = 0;
+
+                        in_place = true;
+                        range_begin = data_begin;
+                        range_end = data_end;
+
+                        // Ignore UTF-8 BOM
+                        if(range_end - range_begin >= 3 && range_begin[0] == '\xEF' && range_begin[1] == '\xBB' && range_begin[2] == '\xBF')
+                                range_begin += 3;
+                }
+
+                char*next_in_place_line(){
+                        if(range_begin == range_end)
+                                return nullptr;
+
+                        ++file_line;
+
+                        char*line_end = detail::find_char(range_begin, range_end, '\n');
+
+                        // Same limit as for buffered lines
+                        if(line_end - range_begin + 1 > block_len){
+                                error::line_length_limit_exceeded err;
+                                err.set_file_name(file_name);
+                                err.set_file_line(file_line);
+                                throw err;
+                        }
+
+                        // A missing newline at the end of the last line is fine, the
+                        // byte at range_end is required to be writable.
+                        *line_end = '\0';
+
+                        // handle windows \r\n-line breaks
+                        if(line_end != range_begin && line_end[-1] == '\r')
+                                line_end[-1] = '\0';
+
+                        char*ret = range_begin;
+                        range_begin = line_end == range_end ? range_end : line_end+1;
+                        return ret;
+                }
+
                 void init(std::unique_ptr<ByteSourceBase>byte_source){
                         file_line = 0;
+                        in_place = false;
 
                         buffer = std::unique_ptr<char[]>(new char[3*block_len]);
                         data_begin = 0;
@@ -371,12 +673,12 @@ namespace io{
 
                 explicit LineReader(const char*file_name){
                         set_file_name(file_name);
-                        init(open_file(file_name));
+                        open_and_init(file_name);
                 }
 
                 explicit LineReader(const std::string&file_name){
                         set_file_name(file_name.c_str());
-                        init(open_file(file_name.c_str()));
+                        open_and_init(file_name.c_str());
                 }
 
                 LineReader(const char*file_name, std::unique_ptr<ByteSourceBase>byte_source){
@@ -399,6 +701,19 @@ namespace io{
                         init(std::unique_ptr<ByteSourceBase>(new detail::NonOwningStringByteSource(data_begin, data_end-data_begin)));
                 }
 
+                // Hands out the lines of [data_begin, data_end) without copying them.
+                // The lines are terminated in place, so the byte at data_end must be
+                // writable unless the range ends with a newline.
+                LineReader(const char*file_name, char*data_begin, char*data_end, in_place_t){
+                        set_file_name(file_name);
+                        init_in_place(data_begin, data_end);
+                }
+
+                LineReader(const std::string&file_name, char*data_begin, char*data_end, in_place_t){
+                        set_file_name(file_name.c_str());
+                        init_in_place(data_begin, data_end);
+                }
+
                 LineReader(const char*file_name, FILE*file){
                         set_file_name(file_name);
                         init(std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file)));
@@ -444,7 +759,8 @@ namespace io{
                         return file_line;
                 }
 
-                char*next_line(){
+        private:
+                char*next_buffered_line(){
                         if(data_begin == data_end)
                                 return nullptr;
 
@@ -465,10 +781,7 @@ namespace io{
                                 }
                         }
 
-                        int line_end = data_begin;
-                        while(line_end != data_end && buffer[line_end] != '\n'){
-                                ++line_end;
-                        }
+                        int line_end = detail::find_char(buffer.get()+data_begin, buffer.get()+data_end, '\n') - buffer.get();
 
                         if(line_end - data_begin + 1 > block_len){
                                 error::line_length_limit_exceeded err;
@@ -494,6 +807,32 @@ namespace io{
                         data_begin = line_end+1;
                         return ret;
                 }
+
+        public:
+                char*next_line(){
+                        if(in_place)
+                                return next_in_place_line();
+
+                        char*line = next_buffered_line();
+                        if(line != nullptr && arena_enabled)
+                                line = copy_to_arena(line);
+                        return line;
+                }
+
+                // While enabled, the lines returned by next_line stay valid until
+                // release_lines is called instead of until the next call, so that
+                // char* and std::string_view columns of many rows can be kept
+                // around. Memory mapped and in place lines never move, for them
+                // this costs nothing and they stay valid for the reader's lifetime.
+                void enable_line_arena(bool enable = true){
+                        arena_enabled = enable;
+                }
+
+                void release_lines(){
+                        arena_blocks.clear();
+                        arena_pos = nullptr;
+                        arena_end = nullptr;
+                }
         };
 
 
@@ -846,15 +1185,62 @@ namespace io{
 
 
         namespace detail{
+                template<class quote_policy>
+                struct column_end_finder{
+                        explicit column_end_finder(const char*){}
+
+                        const char*operator()(const char*col_begin){
+                                return quote_policy::find_next_column_end(col_begin);
+                        }
+                };
+
+                #ifdef CSV_IO_HAS_SIMD
+                // Finds the separators of one line a 64 byte block at a time and
+                // keeps the block's mask around, so that all the short columns of a
+                // typical line are found with one or two block scans. The blocks
+                // start at the line and never reach past its terminating '\0', the
+                // bytes after the last whole block are scanned one by one. Must not
+                // be reused across lines, as their terminating '\0' is written later.
+                template<char sep>
+                struct column_end_finder<no_quote_escape<sep>>{
+                        const char*next_block;
+                        const char*readable_end;
+                        std::uint64_t mask = 0;
+
+                        explicit column_end_finder(const char*line):
+                                next_block(line), readable_end(line + std::strlen(line) + 1){}
+
+                        const char*operator()(const char*col_begin){
+                                const char*from = col_begin;
+                                for(;;){
+                                        if(from < next_block){
+                                                std::uint64_t remaining = mask >> (from - (next_block - 64));
+                                                if(remaining != 0)
+                                                        return from + __builtin_ctzll(remaining);
+                                                from = next_block;
+                                        }
+                                        if(readable_end - next_block < 64)
+                                                break;
+                                        mask = char_or_nul_mask(next_block, sep);
+                                        next_block += 64;
+                                }
+                                while(*from != sep && *from != '\0')
+                                        ++from;
+                                return from;
+                        }
+                };
+                #endif
+
                 template<class quote_policy>
                 void chop_next_column(
-                        char*&line, char*&col_begin, char*&col_end
+                        char*&line, char*&col_begin, char*&col_end,
+                        column_end_finder<quote_policy>&find_column_end
                 ){
                         assert(line != nullptr);
 
                         col_begin = line;
                         // the col_begin + (... - col_begin) removes the constness
-                        col_end = col_begin + (quote_policy::find_next_column_end(col_begin) - col_begin);
+                        col_end = col_begin + (find_column_end(col_begin) - col_begin);
 
                         if(*col_end == '\0'){
                                 line = nullptr;
@@ -864,17 +1250,26 @@ namespace io{
                         }
                 }
 
+                template<class quote_policy>
+                void chop_next_column(
+                        char*&line, char*&col_begin, char*&col_end
+                ){
+                        column_end_finder<quote_policy>find_column_end(line);
+                        chop_next_column<quote_policy>(line, col_begin, col_end, find_column_end);
+                }
+
                 template<class trim_policy, class quote_policy>
                 void parse_line(
                         char*line,
                         char**sorted_col,
                         const std::vector<int>&col_order
                 ){
+                        column_end_finder<quote_policy>find_column_end(line);
                         for (int i : col_order) {
                                 if(line == nullptr)
                                         throw ::io::error::too_few_columns();
                                 char*col_begin, *col_end;
-                                chop_next_column<quote_policy>(line, col_begin, col_end);
+                                chop_next_column<quote_policy>(line, col_begin, col_end, find_column_end);
 
                                 if (i != -1) {
                                         trim_policy::trim(col_begin, col_end);
@@ -963,6 +1358,13 @@ namespace io{
                         x = col;
                 }
 
+                #ifdef CSV_IO_HAS_STRING_VIEW
+                template<class overflow_policy>
+                void parse(char*col, std::string_view&x){
+                        x = col;
+                }
+                #endif
+
                 template<class overflow_policy, class T>
                 void parse_unsigned_integer(const char*col, T&x){
                         x = 0;
@@ -1027,7 +1429,7 @@ namespace io{
                         {parse_signed_integer<overflow_policy>(col, x);}
 
                 template<class T>
-                void parse_float(const char*col, T&x){
+                void parse_float_digit_by_digit(const char*col, T&x){
                         bool is_neg = false;
                         if(*col == '-'){
                                 is_neg = true;
@@ -1089,6 +1491,128 @@ namespace io{
                                 x = -x;
                 }
 
+                // Values whose decimal mantissa and power of ten are both exactly
+                // representable are correctly rounded by a single division.
+                template<class T>
+                struct exact_float_limits;
+
+                template<>
+                struct exact_float_limits<float>{
+                        static const std::uint64_t max_mantissa = std::uint64_t(1) << 24;
+                        static const int max_power_of_ten = 10;
+                };
+
+                template<>
+                struct exact_float_limits<double>{
+                        static const std::uint64_t max_mantissa = std::uint64_t(1) << 53;
+                        static const int max_power_of_ten = 22;
+                };
+
+                // Handles plain decimals such as the coordinates in tubesheet.csv
+                // without any rounding error. Returns false for anything else,
+                // e.g. exponents or too many digits.
+                template<class T>
+                bool parse_float_fast_path(const char*col, T&x){
+                        static const T powers_of_ten[] = {
+                                T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7),
+                                T(1e8), T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14), T(1e15),
+                                T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22)
+                        };
+
+                        bool is_neg = false;
+                        if(*col == '-'){
+                                is_neg = true;
+                                ++col;
+                        }else if(*col == '+')
+                                ++col;
+
+                        std::uint64_t mantissa = 0;
+                        int digit_count = 0;
+                        int fraction_digit_count = 0;
+                        while('0' <= *col && *col <= '9'){
+                                mantissa = 10*mantissa + (*col - '0');
+                                ++digit_count;
+                                ++col;
+                        }
+                        if(*col == '.' || *col == ','){
+                                ++col;
+                                while('0' <= *col && *col <= '9'){
+                                        mantissa = 10*mantissa + (*col - '0');
+                                        ++digit_count;
+                                        ++fraction_digit_count;
+                                        ++col;
+                                }
+                        }
+
+                        if(*col != '\0' || digit_count == 0 || digit_count > 19)
+                                return false;
+                        if(mantissa > exact_float_limits<T>::max_mantissa || fraction_digit_count > exact_float_limits<T>::max_power_of_ten)
+                                return false;
+
+                        x = T(mantissa) / powers_of_ten[fraction_digit_count];
+                        if(is_neg)
+                                x = -x;
+                        return true;
+                }
+
+                #ifdef CSV_IO_HAS_FROM_CHARS
+                // Correctly rounded parsing of the remaining forms. Returns false for
+                // anything std::from_chars does not fully accept (empty columns,
+                // inf/nan, out of range values, garbage) and leaves those to
+                // parse_float_digit_by_digit, so that the accepted syntax and the
+                // errors do not change.
+                template<class T>
+                bool parse_float_from_chars(const char*col, T&x){
+                        bool is_neg = false;
+                        if(*col == '-'){
+                                is_neg = true;
+                                ++col;
+                        }else if(*col == '+')
+                                ++col;
+
+                        if(!('0' <= *col && *col <= '9') && *col != '.' && *col != ',')
+                                return false;
+
+                        const char*col_end = col + std::strlen(col);
+                        std::from_chars_result result = std::from_chars(col, col_end, x);
+                        if(result.ec == std::errc() && result.ptr != col_end && *result.ptr == ','){
+                                // from_chars only knows '.' as decimal separator
+                                char buffer[64];
+                                if(col_end - col >= static_cast<std::ptrdiff_t>(sizeof(buffer)))
+                                        return false;
+                                std::replace_copy(col, col_end + 1, buffer, ',', '.');
+                                col_end = buffer + (col_end - col);
+                                result = std::from_chars(buffer, col_end, x);
+                        }else if(*col == ','){
+                                return false;
+                        }
+                        if(result.ec != std::errc() || result.ptr != col_end)
+                                return false;
+
+                        if(is_neg)
+                                x = -x;
+                        return true;
+                }
+                #endif
+
+                template<class T>
+                void parse_float(const char*col, T&x){
+                        #if FLT_EVAL_METHOD == 0
+                        if(parse_float_fast_path(col, x))
+                                return;
+                        #endif
+                        #ifdef CSV_IO_HAS_FROM_CHARS
+                        if(parse_float_from_chars(col, x))
+                                return;
+                        #endif
+                        parse_float_digit_by_digit(col, x);
+                }
+
+                template<>
+                inline void parse_float(const char*col, long double&x){
+                        parse_float_digit_by_digit(col, x);
+                }
+
                 template<class overflow_policy> void parse(char*col, float&x) { parse_float(col, x); }
                 template<class overflow_policy> void parse(char*col, double&x) { parse_float(col, x); }
                 template<class overflow_policy> void parse(char*col, long double&x) { parse_float(col, x); }
@@ -1102,7 +1626,7 @@ namespace io{
                         // "sizeof(T)!=sizeof(T)" only when instantiating it. This is why
                         // this strange construct is used.
                         static_assert(sizeof(T)!=sizeof(T),
-                                "Can not parse this type. Only buildin integrals, floats, char, char*, const char* and std::string are supported");
+                                "Can not parse this type. Only buildin integrals, floats, char, char*, const char*, std::string and std::string_view are supported");
                 }
 
         }
@@ -1186,6 +1710,13 @@ namespace io{
                                 col_order[i] = i;
                 }
 
+                // Adopts the column layout of a reader whose header has already been
+                // read, e.g. to parse several chunks of the same file independently.
+                void copy_header(const CSVReader&other){
+                        std::copy(std::begin(other.column_names), std::end(other.column_names), std::begin(column_names));
+                        col_order = other.col_order;
+                }
+
                 bool has_column(const std::string&name) const {
                         return col_order.end() != std::find(
                                 col_order.begin(), col_order.end(),
@@ -1209,6 +1740,18 @@ namespace io{
                         in.set_file_line(file_line);
                 }
 
+                // Keeps the bytes of every row read from now on alive until
+                // release_rows, see LineReader::enable_line_arena. With it,
+                // char* and std::string_view columns can be stored without
+                // copying them.
+                void enable_row_arena(bool enable = true){
+                        in.enable_line_arena(enable);
+                }
+
+                void release_rows(){
+                        in.release_lines();
+                }
+
                 unsigned get_file_line()const{
                         return in.get_file_line();
                 }
@@ -1267,6 +1810,68 @@ namespace io{
 
                         return true;
                 }
+
+                // Appends up to n rows to the column vectors, one vector per
+                // column, and returns the number of rows appended. Fewer than n
+                // rows means the file is exhausted. The line lookup and error
+                // bookkeeping are done once per batch instead of once per row.
+                // If a row fails to parse, the rows before it are kept and the
+                // vectors are truncated to them before the error propagates.
+                template<class ...ColType>
+                std::size_t read_rows(std::size_t n, std::vector<ColType>& ...cols){
+                        static_assert(sizeof...(ColType)>=column_count,
+                                "not enough columns specified");
+                        static_assert(sizeof...(ColType)<=column_count,
+                                "too many columns specified");
+                        std::size_t count = 0;
+                        std::size_t first = first_size(cols...);
+                        try{
+                                try{
+                                        while(count < n){
+                                                char*line;
+                                                do{
+                                                        line = in.next_line();
+                                                        if(!line)
+                                                                return count;
+                                                }while(comment_policy::is_comment(line));
+
+                                                detail::parse_line<trim_policy, quote_policy>
+                                                        (line, row, col_order);
+
+                                                parse_helper(0, (cols.emplace_back(), cols.back())...);
+                                                ++count;
+                                        }
+                                }catch(error::with_file_name&err){
+                                        err.set_file_name(in.get_truncated_file_name());
+                                        throw;
+                                }
+                        }catch(error::with_file_line&err){
+                                truncate_columns(first+count, cols...);
+                                err.set_file_line(in.get_file_line());
+                                throw;
+                        }catch(...){
+                                truncate_columns(first+count, cols...);
+                                throw;
+                        }
+
+                        return count;
+                }
+
+        private:
+                static std::size_t first_size(){
+                        return 0;
+                }
+
+                template<class T, class ...ColType>
+                static std::size_t first_size(const std::vector<T>&col, const std::vector<ColType>&...){
+                        return col.size();
+                }
+
+                template<class ...ColType>
+                static void truncate_columns(std::size_t size, std::vector<ColType>& ...cols){
+                        int expand[] = {0, (cols.resize(size), 0)...};
+                        (void)expand;
+                }
         };
 }
 #endif
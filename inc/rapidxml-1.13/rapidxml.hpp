@@ -556,6 +556,38 @@ namespace rapidxml
             m_free_func = ff;
         }
 
+        //! Makes sure the next allocations of up to given total size are served from a single block.
+        //! If the current block has less room left, a new block of at least that size is allocated now,
+        //! so building a tree of known size takes one dynamic allocation instead of many.
+        //! \param size Total size in bytes of the allocations to come, including alignment.
+        void reserve(std::size_t size)
+        {
+            if (align(m_ptr) + size > m_end)
+                allocate_block(size);
+        }
+
+        //! Gets the number of bytes handed out by the pool since construction or the last clear(), including alignment.
+        //! As the pool never releases single allocations, this is also its high-water mark.
+        //! \return Allocated size in bytes.
+        std::size_t allocated_size() const
+        {
+            return m_allocated;
+        }
+
+        //! Gets the number of bytes the pool obtained from the allocation function, not counting the static block.
+        //! \return Size of the dynamic blocks in bytes.
+        std::size_t dynamic_size() const
+        {
+            return m_dynamic_size;
+        }
+
+        //! Gets the number of dynamic blocks the pool obtained from the allocation function.
+        //! \return Number of dynamic blocks.
+        std::size_t dynamic_block_count() const
+        {
+            return m_dynamic_blocks;
+        }
+
     private:
 
         struct header
@@ -568,6 +600,9 @@ namespace rapidxml
             m_begin = m_static_memory;
             m_ptr = align(m_begin);
             m_end = m_static_memory + sizeof(m_static_memory);
+            m_allocated = 0;
+            m_dynamic_size = 0;
+            m_dynamic_blocks = 0;
         }
         
         char *align(char *ptr)
@@ -604,38 +639,49 @@ namespace rapidxml
             // If not enough memory left in current pool, allocate a new pool
             if (result + size > m_end)
             {
-                // Calculate required pool size (may be bigger than RAPIDXML_DYNAMIC_POOL_SIZE)
-                std::size_t pool_size = RAPIDXML_DYNAMIC_POOL_SIZE;
-                if (pool_size < size)
-                    pool_size = size;
-                
-                // Allocate
-                std::size_t alloc_size = sizeof(header) + (2 * RAPIDXML_ALIGNMENT - 2) + pool_size;     // 2 alignments required in worst case: one for header, one for actual allocation
-                char *raw_memory = allocate_raw(alloc_size);
-                    
-                // Setup new pool in allocated memory
-                char *pool = align(raw_memory);
-                header *new_header = reinterpret_cast<header *>(pool);
-                new_header->previous_begin = m_begin;
-                m_begin = raw_memory;
-                m_ptr = pool + sizeof(header);
-                m_end = raw_memory + alloc_size;
+                allocate_block(size);
 
                 // Calculate aligned pointer again using new pool
                 result = align(m_ptr);
             }
 
             // Update pool and return aligned pointer
+            m_allocated += result + size - m_ptr;
             m_ptr = result + size;
             return result;
         }
 
+        void allocate_block(std::size_t size)
+        {
+            // Calculate required pool size (may be bigger than RAPIDXML_DYNAMIC_POOL_SIZE)
+            std::size_t pool_size = RAPIDXML_DYNAMIC_POOL_SIZE;
+            if (pool_size < size)
+                pool_size = size;
+
+            // Allocate
+            std::size_t alloc_size = sizeof(header) + (2 * RAPIDXML_ALIGNMENT - 2) + pool_size;     // 2 alignments required in worst case: one for header, one for actual allocation
+            char *raw_memory = allocate_raw(alloc_size);
+            m_dynamic_size += alloc_size;
+            ++m_dynamic_blocks;
+
+            // Setup new pool in allocated memory
+            char *pool = align(raw_memory);
+            header *new_header = reinterpret_cast<header *>(pool);
+            new_header->previous_begin = m_begin;
+            m_begin = raw_memory;
+            m_ptr = pool + sizeof(header);
+            m_end = raw_memory + alloc_size;
+        }
+
         char *m_begin;                                      // Start of raw memory making up current pool
         char *m_ptr;                                        // First free byte in current pool
         char *m_end;                                        // One past last available byte in current pool
         char m_static_memory[RAPIDXML_STATIC_POOL_SIZE];    // Static raw memory
         alloc_func *m_alloc_func;                           // Allocator function, or 0 if default is to be used
         free_func *m_free_func;                             // Free function, or 0 if default is to be used
+        std::size_t m_allocated;                            // Bytes handed out including alignment
+        std::size_t m_dynamic_size;                         // Bytes obtained from the allocator
+        std::size_t m_dynamic_blocks;                       // Blocks obtained from the allocator
     };
 
     ///////////////////////////////////////////////////////////////////////////
@@ -658,6 +704,7 @@ namespace rapidxml
             : m_name(0)
             , m_value(0)
             , m_parent(0)
+            , m_value_safe(false)
         {
         }
 
@@ -752,6 +799,7 @@ namespace rapidxml
         {
             m_value = const_cast<Ch *>(value);
             m_value_size = size;
+            m_value_safe = false;
         }
 
         //! Sets value of node to a zero-terminated string.
@@ -762,6 +810,22 @@ namespace rapidxml
             this->value(value, internal::measure(value));
         }
 
+        //! Marks the current value as free of characters that printing would expand into references (&lt; &gt; &apos; &quot; &amp;), e.g. a number.
+        //! The buffered printer then copies it without looking at it.
+        //! Setting a new value clears the mark.
+        //! \param safe True if the value never needs expanding.
+        void value_safe(bool safe)
+        {
+            m_value_safe = safe;
+        }
+
+        //! Checks whether the value was marked with value_safe(bool).
+        //! \return True if the value never needs expanding.
+        bool value_safe() const
+        {
+            return m_value_safe;
+        }
+
         ///////////////////////////////////////////////////////////////////////////
         // Related nodes access
     
@@ -786,6 +850,7 @@ namespace rapidxml
         std::size_t m_name_size;            // Length of node name, or undefined of no name
         std::size_t m_value_size;           // Length of node value, or undefined if no value
         xml_node<Ch> *m_parent;             // Pointer to parent node, or 0 if none
+        bool m_value_safe;                  // Value needs no character references when printed
 
     };
 
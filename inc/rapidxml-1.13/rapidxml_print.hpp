@@ -7,6 +7,8 @@
 //! \file rapidxml_print.hpp This file contains rapidxml printer implementation
 
 #include "rapidxml.hpp"
+#include <cstring>
+#include <string>
 
 // Only include streams if not disabled
 #ifndef RAPIDXML_NO_STREAMS
@@ -22,6 +24,101 @@ namespace rapidxml
 
     const int print_no_indenting = 0x1;   //!< Printer flag instructing the printer to suppress indenting of XML. See print() function.
 
+    ///////////////////////////////////////////////////////////////////////
+    // Print buffer
+
+    //! Growable contiguous character buffer that print() appends to.
+    //! Names and values are copied into it in bulk, and values only go through character by character
+    //! expansion where they contain characters that need it. Values marked with xml_base::value_safe(bool)
+    //! are not looked at. The buffer keeps its capacity when cleared, so it can be reused for several documents.
+    template<class Ch = char>
+    class print_buffer
+    {
+
+    public:
+
+        //! Appends a range of characters as is.
+        //! \param begin First character.
+        //! \param size Number of characters.
+        void append(const Ch *begin, std::size_t size)
+        {
+            m_text.append(begin, size);
+        }
+
+        //! Appends a single character.
+        //! \param ch Character to append.
+        void append(Ch ch)
+        {
+            m_text.push_back(ch);
+        }
+
+        //! Appends n repetitions of a character.
+        void fill(std::size_t n, Ch ch)
+        {
+            m_text.append(n, ch);
+        }
+
+        //! Appends a range of characters, expanding characters into references (&lt; &gt; &apos; &quot; &amp;).
+        //! Runs of characters between the expanded ones are copied at once.
+        //! \param begin First character.
+        //! \param size Number of characters.
+        //! \param noexpand Character that is copied although it would normally be expanded.
+        void append_expanded(const Ch *begin, std::size_t size, Ch noexpand)
+        {
+            const Ch *run = begin;
+            const Ch *end = begin + size;
+            for (const Ch *ch = begin; ch != end; ++ch)
+            {
+                const char *reference;
+                switch (*ch)
+                {
+                case Ch('<'): reference = "&lt;"; break;
+                case Ch('>'): reference = "&gt;"; break;
+                case Ch('\''): reference = "&apos;"; break;
+                case Ch('"'): reference = "&quot;"; break;
+                case Ch('&'): reference = "&amp;"; break;
+                default: continue;
+                }
+                if (*ch == noexpand)
+                    continue;
+                m_text.append(run, ch);
+                while (*reference)
+                    m_text.push_back(Ch(*reference++));
+                run = ch + 1;
+            }
+            m_text.append(run, end);
+        }
+
+        //! Reserves room for a number of characters.
+        void reserve(std::size_t size)
+        {
+            m_text.reserve(size);
+        }
+
+        //! Gets the printed characters, which are not zero terminated.
+        const Ch *data() const
+        {
+            return m_text.data();
+        }
+
+        //! Gets the number of printed characters.
+        std::size_t size() const
+        {
+            return m_text.size();
+        }
+
+        //! Removes all characters, keeping the allocated capacity.
+        void clear()
+        {
+            m_text.clear();
+        }
+
+    private:
+
+        std::basic_string<Ch> m_text;
+
+    };
+
     ///////////////////////////////////////////////////////////////////////
     // Internal
 
@@ -401,6 +498,168 @@ namespace rapidxml
             return out;
         }
 
+        ///////////////////////////////////////////////////////////////////////////
+        // Internal printing operations into a print_buffer
+
+        template<class Ch>
+        inline void print_buffered_node(print_buffer<Ch> &out, const xml_node<Ch> *node, int flags, int indent);
+
+        // Print value of node or attribute, expanding character references unless it is marked safe
+        template<class Ch>
+        inline void print_buffered_value(print_buffer<Ch> &out, const xml_base<Ch> *base, Ch noexpand)
+        {
+            if (base->value_safe())
+                out.append(base->value(), base->value_size());
+            else
+                out.append_expanded(base->value(), base->value_size(), noexpand);
+        }
+
+        template<class Ch>
+        inline void print_buffered_attributes(print_buffer<Ch> &out, const xml_node<Ch> *node)
+        {
+            for (xml_attribute<Ch> *attribute = node->first_attribute(); attribute; attribute = attribute->next_attribute())
+            {
+                if (attribute->name() && attribute->value())
+                {
+                    out.append(Ch(' '));
+                    out.append(attribute->name(), attribute->name_size());
+                    out.append(Ch('='));
+                    // Same choice of quote type as print_attributes
+                    if (!attribute->value_safe() && find_char<Ch, Ch('"')>(attribute->value(), attribute->value() + attribute->value_size()))
+                    {
+                        out.append(Ch('\''));
+                        print_buffered_value(out, attribute, Ch('"'));
+                        out.append(Ch('\''));
+                    }
+                    else
+                    {
+                        out.append(Ch('"'));
+                        print_buffered_value(out, attribute, Ch('\''));
+                        out.append(Ch('"'));
+                    }
+                }
+            }
+        }
+
+        // Print opening of a node with a fixed prefix, e.g. "<!--"
+        template<class Ch>
+        inline void print_buffered_start(print_buffer<Ch> &out, const char *prefix, int flags, int indent)
+        {
+            if (!(flags & print_no_indenting))
+                out.fill(indent, Ch('\t'));
+            while (*prefix)
+                out.append(Ch(*prefix++));
+        }
+
+        template<class Ch>
+        inline void print_buffered_element(print_buffer<Ch> &out, const xml_node<Ch> *node, int flags, int indent)
+        {
+            print_buffered_start(out, "<", flags, indent);
+            out.append(node->name(), node->name_size());
+            print_buffered_attributes(out, node);
+
+            if (node->value_size() == 0 && !node->first_node())
+            {
+                out.append(Ch('/'));
+                out.append(Ch('>'));
+                return;
+            }
+
+            out.append(Ch('>'));
+            xml_node<Ch> *child = node->first_node();
+            if (!child)
+            {
+                print_buffered_value(out, node, Ch(0));
+            }
+            else if (child->next_sibling() == 0 && child->type() == node_data)
+            {
+                print_buffered_value(out, child, Ch(0));
+            }
+            else
+            {
+                if (!(flags & print_no_indenting))
+                    out.append(Ch('\n'));
+                print_buffered_value(out, node, Ch(0));
+                for (; child; child = child->next_sibling())
+                    print_buffered_node(out, child, flags, indent + 1);
+                if (!(flags & print_no_indenting))
+                    out.fill(indent, Ch('\t'));
+            }
+            out.append(Ch('<'));
+            out.append(Ch('/'));
+            out.append(node->name(), node->name_size());
+            out.append(Ch('>'));
+        }
+
+        // Same output as print_node
+        template<class Ch>
+        inline void print_buffered_node(print_buffer<Ch> &out, const xml_node<Ch> *node, int flags, int indent)
+        {
+            switch (node->type())
+            {
+
+            case node_document:
+                for (xml_node<Ch> *child = node->first_node(); child; child = child->next_sibling())
+                    print_buffered_node(out, child, flags, indent);
+                break;
+
+            case node_element:
+                print_buffered_element(out, node, flags, indent);
+                break;
+
+            case node_data:
+                if (!(flags & print_no_indenting))
+                    out.fill(indent, Ch('\t'));
+                print_buffered_value(out, node, Ch(0));
+                break;
+
+            case node_cdata:
+                print_buffered_start(out, "<![CDATA[", flags, indent);
+                out.append(node->value(), node->value_size());
+                out.append(Ch(']'));
+                out.append(Ch(']'));
+                out.append(Ch('>'));
+                break;
+
+            case node_declaration:
+                print_buffered_start(out, "<?xml", flags, indent);
+                print_buffered_attributes(out, node);
+                out.append(Ch('?'));
+                out.append(Ch('>'));
+                break;
+
+            case node_comment:
+                print_buffered_start(out, "<!--", flags, indent);
+                out.append(node->value(), node->value_size());
+                out.append(Ch('-'));
+                out.append(Ch('-'));
+                out.append(Ch('>'));
+                break;
+
+            case node_doctype:
+                print_buffered_start(out, "<!DOCTYPE ", flags, indent);
+                out.append(node->value(), node->value_size());
+                out.append(Ch('>'));
+                break;
+
+            case node_pi:
+                print_buffered_start(out, "<?", flags, indent);
+                out.append(node->name(), node->name_size());
+                out.append(Ch(' '));
+                out.append(node->value(), node->value_size());
+                out.append(Ch('?'));
+                out.append(Ch('>'));
+                break;
+
+            default:
+                assert(0);
+                break;
+            }
+
+            if (!(flags & print_no_indenting))
+                out.append(Ch('\n'));
+        }
+
     }
     //! \endcond
 
@@ -418,6 +677,16 @@ namespace rapidxml
         return internal::print_node(out, &node, flags, 0);
     }
 
+    //! Prints XML to the end of a print_buffer. Output is the same as that of the other print() functions.
+    //! \param out Buffer to print to.
+    //! \param node Node to be printed. Pass xml_document to print entire document.
+    //! \param flags Flags controlling how XML is printed.
+    template<class Ch>
+    inline void print(print_buffer<Ch> &out, const xml_node<Ch> &node, int flags = 0)
+    {
+        internal::print_buffered_node(out, &node, flags, 0);
+    }
+
 #ifndef RAPIDXML_NO_STREAMS
 
     //! Prints XML to given output stream.
@@ -432,6 +701,21 @@ namespace rapidxml
         return out;
     }
 
+    //! Prints XML to given output stream with a single write(), through a print_buffer.
+    //! Much faster than print(std::basic_ostream<Ch> &, ...), which writes every character through an ostream_iterator.
+    //! \param out Output stream to print to.
+    //! \param node Node to be printed. Pass xml_document to print entire document.
+    //! \param flags Flags controlling how XML is printed.
+    //! \return Output stream.
+    template<class Ch>
+    inline std::basic_ostream<Ch> &print_buffered(std::basic_ostream<Ch> &out, const xml_node<Ch> &node, int flags = 0)
+    {
+        print_buffer<Ch> buffer;
+        print(buffer, node, flags);
+        out.write(buffer.data(), buffer.size());
+        return out;
+    }
+
     //! Prints formatted XML to given output stream. Uses default printing flags. Use print() function to customize printing process.
     //! \param out Output stream to print to.
     //! \param node Node to be printed.
@@ -0,0 +1,190 @@
+#include "insp_plan.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "inc/csv.h"
+#include "tubesheet_csv.h"
+
+insp_plan read_insp_plan(const char *file_name) {
+    io::CSVReader<3, io::trim_chars<' ', '\t'>, io::no_quote_escape<';'>> in(
+            file_name);
+    in.read_header(io::ignore_extra_column, "ROW", "COL", "TUBE");
+
+    insp_plan plan;
+    std::string_view path(file_name);
+    std::size_t slash = path.find_last_of("/\\");
+    std::string_view name =
+            slash == std::string_view::npos ? path : path.substr(slash + 1);
+    plan.name = std::string(name.substr(0, name.rfind('.')));
+
+    std::uint16_t row;
+    std::uint16_t col;
+    std::string_view tube_id;
+    while (in.read_row(row, col, tube_id)) {
+        std::uint32_t number;
+        if (!parse_tube_number(tube_id, number)) {
+            throw_invalid_tube_id(in.get_truncated_file_name(),
+                    in.get_file_line(), tube_id);
+        }
+        plan.row.push_back(row);
+        plan.col.push_back(col);
+        plan.tube_number.push_back(number);
+    }
+    return plan;
+}
+
+plan_match match_plan(const insp_plan &plan, const tube_table &tubes,
+        plan_legs legs) {
+    plan_match match;
+    match.tubes.reserve(legs == plan_legs::both ? 2 * plan.size() : plan.size());
+    for (std::size_t k = 0; k < plan.size(); ++k) {
+        bool found = false;
+        for (tube_leg leg : { tube_leg::hl, tube_leg::cl }) {
+            if ((leg == tube_leg::hl && legs == plan_legs::cl)
+                    || (leg == tube_leg::cl && legs == plan_legs::hl)) {
+                continue;
+            }
+            std::size_t i = tubes.find(leg, plan.tube_number[k]);
+            if (i == tube_table::npos) {
+                continue;
+            }
+            if (!found && (tubes.col[i] != plan.row[k]
+                    || tubes.row[i] != plan.col[k])) {
+                ++match.mislabeled;
+            }
+            found = true;
+            match.tubes.push_back(i);
+        }
+        if (!found) {
+            ++match.unknown;
+        }
+    }
+    return match;
+}
+
+tube_set plan_tube_set(const plan_match &match, const tube_table &tubes) {
+    tube_set set(tubes.size());
+    for (std::uint32_t i : match.tubes) {
+        set.insert(i);
+    }
+    return set;
+}
+
+tube_set leg_tube_set(const tube_table &tubes, plan_legs legs) {
+    if (legs == plan_legs::both) {
+        return tube_set(tubes.size(), true);
+    }
+    tube_leg side = legs == plan_legs::hl ? tube_leg::hl : tube_leg::cl;
+    tube_set set(tubes.size());
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        if (tubes.leg[i] == side) {
+            set.insert(i);
+        }
+    }
+    return set;
+}
+
+insp_plan make_insp_plan(const std::string &name, const tube_set &set,
+        const tube_table &tubes) {
+    insp_plan plan;
+    plan.name = name;
+    std::unordered_set<std::uint32_t> listed;
+    for (std::uint32_t i : set.indices()) {
+        if (listed.insert(tubes.number[i]).second) {
+            plan.row.push_back(tubes.col[i]);
+            plan.col.push_back(tubes.row[i]);
+            plan.tube_number.push_back(tubes.number[i]);
+        }
+    }
+    return plan;
+}
+
+void write_insp_plan(const char *file_name, const insp_plan &plan) {
+    // Same CRLF lines as the shipped plans
+    std::string text = "ROW;COL;TUBE\r\n";
+    for (std::size_t k = 0; k < plan.size(); ++k) {
+        text += std::to_string(plan.row[k]);
+        text += ';';
+        text += std::to_string(plan.col[k]);
+        text += ";TUBE.";
+        text += std::to_string(plan.tube_number[k]);
+        text += "\r\n";
+    }
+    std::ofstream file(file_name, std::ios::binary);
+    file.write(text.data(), text.size());
+    file.close();
+    if (!file) {
+        throw std::runtime_error(std::string("Can not write ") + file_name);
+    }
+}
+
+std::string plan_class(const std::string &plan_name) {
+    std::string name = "plan_";
+    for (char c : plan_name) {
+        name += std::isalnum(static_cast<unsigned char>(c)) || c == '-' ? c : '_';
+    }
+    return name;
+}
+
+tube_overlay make_plan_overlay(const std::vector<insp_plan> &plans,
+        const std::vector<plan_match> &matches, const tube_table &tubes) {
+    // Fills that stay apart on the white tubes and from each other
+    static const char *const fills[] = { "#e6194b", "#3cb44b", "#4363d8",
+            "#f58231", "#911eb4", "#42d4f4", "#f032e6", "#bfef45", "#469990",
+            "#9a6324" };
+    const std::size_t fill_count = sizeof(fills) / sizeof(fills[0]);
+
+    tube_overlay overlay;
+    overlay.classes.push_back("tube");
+    overlay.class_of.assign(tubes.size(), 0);
+
+    // The class attribute of every planned tube, built plan by plan
+    std::unordered_map<std::uint32_t, std::string> planned;
+    for (std::size_t p = 0; p < plans.size(); ++p) {
+        std::string name = plan_class(plans[p].name);
+        overlay.css += " .";
+        overlay.css += name;
+        overlay.css += " {fill: ";
+        overlay.css += fills[p % fill_count];
+        overlay.css += ";}";
+
+        for (std::uint32_t i : matches[p].tubes) {
+            std::string &classes = planned[i];
+            if (classes.empty()) {
+                classes = "tube";
+            }
+            // Plans list a tube once, but nothing keeps them from repeating
+            if (classes.size() < name.size()
+                    || classes.compare(classes.size() - name.size(),
+                            name.size(), name) != 0) {
+                classes += ' ';
+                classes += name;
+            }
+        }
+    }
+
+    // Distinct combinations are numbered in tube order, which keeps the
+    // output independent of the hash order
+    std::vector<std::uint32_t> order;
+    order.reserve(planned.size());
+    for (const auto &tube : planned) {
+        order.push_back(tube.first);
+    }
+    std::sort(order.begin(), order.end());
+    std::unordered_map<std::string, std::uint32_t> combinations;
+    for (std::uint32_t i : order) {
+        const std::string &classes = planned[i];
+        auto found = combinations.find(classes);
+        if (found == combinations.end()) {
+            found = combinations.emplace(classes, overlay.classes.size()).first;
+            overlay.classes.push_back(classes);
+        }
+        overlay.class_of[i] = found->second;
+    }
+    return overlay;
+}
@@ -0,0 +1,70 @@
+#ifndef INSP_PLAN_H
+#define INSP_PLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tube_set.h"
+#include "tube_table.h"
+#include "tubesheet_svg.h"
+
+// An inspection plan, insp_plans/InspPlanN_M_k.csv: the tubes to inspect in
+// order, one element per line
+struct insp_plan {
+    // File name without directory and extension, "InspPlan1_M_1"
+    std::string name;
+    // The ROW and COL columns hold the x_label and y_label of the tube
+    std::vector<std::uint16_t> row;
+    std::vector<std::uint16_t> col;
+    // The n of the "TUBE.n" TUBE column
+    std::vector<std::uint32_t> tube_number;
+
+    std::size_t size() const {
+        return tube_number.size();
+    }
+};
+
+insp_plan read_insp_plan(const char *file_name);
+
+// Plans name tubes by number only; the legs of the tube they apply to
+enum class plan_legs {
+    hl, cl, both
+};
+
+// The tube table indices of a plan's tubes, in plan order
+struct plan_match {
+    std::vector<std::uint32_t> tubes;
+    // Plan lines whose tube is not in the table
+    std::size_t unknown = 0;
+    // Plan lines whose ROW and COL differ from the labels of the tube
+    std::size_t mislabeled = 0;
+};
+
+plan_match match_plan(const insp_plan &plan, const tube_table &tubes,
+        plan_legs legs);
+
+// The matched tubes as a set over the tube table
+tube_set plan_tube_set(const plan_match &match, const tube_table &tubes);
+
+// The tubes of the table on the given legs
+tube_set leg_tube_set(const tube_table &tubes, plan_legs legs);
+
+// A plan of the tubes of a set, in table order. Plans name tubes by number
+// only, so a tube in the set with both legs is listed once.
+insp_plan make_insp_plan(const std::string &name, const tube_set &set,
+        const tube_table &tubes);
+
+// Writes the plan in the format of insp_plans/*.csv. Throws
+// std::runtime_error if it can not be written.
+void write_insp_plan(const char *file_name, const insp_plan &plan);
+
+// "plan_InspPlan1_M_1"
+std::string plan_class(const std::string &plan_name);
+
+// Colors the tubes of every plan through a class of its own. A tube in
+// several plans gets all their classes, the fill of the last plan wins.
+tube_overlay make_plan_overlay(const std::vector<insp_plan> &plans,
+        const std::vector<plan_match> &matches, const tube_table &tubes);
+
+#endif
@@ -1,229 +1,324 @@
 #include <iostream>
-#include <fstream>
-#include <map>
-#include <utility>
+#include <charconv>
+#include <cstring>
+#include <exception>
 #include <filesystem>
-#include <algorithm>
-#include <cmath>
-#include "inc/csv.h"
+#include <fstream>
+#include <string>
+#include <vector>
 #include "inc/rapidxml-1.13/rapidxml.hpp"
-#include "inc/rapidxml-1.13/rapidxml_utils.hpp"
 #include "inc/rapidxml-1.13/rapidxml_print.hpp"
-
-struct tube {
-    std::string x_label;
-    std::string y_label;
-    std::string leg;
-    float x;
-    float y;
-};
-
-void append_attributes(rapidxml::xml_document<char> &doc,
-        rapidxml::xml_node<char> *node,
-        std::map<std::string, std::string> attrs) {
-    if (node) {
-
-        for (auto attr : attrs) {
-            node->append_attribute(
-                    doc.allocate_attribute(
-                            doc.allocate_string(attr.first.c_str()),
-                            doc.allocate_string(attr.second.c_str())));
+#include "insp_plan.h"
+#include "parallel.h"
+#include "plan_batch.h"
+#include "plan_expr.h"
+#include "plan_partition.h"
+#include "plan_route.h"
+#include "svg_writer.h"
+#include "tube_index.h"
+#include "tube_table.h"
+#include "tubesheet_cache.h"
+#include "tubesheet_svg.h"
+#include "tubesheet_tiles.h"
+
+// Malformed input files, plans and plan expressions end the run with the
+// message of their exception
+int main(int argc, char *argv[]) try {
+    unsigned threads = 1;
+    bool use_cache = true;
+    bool use_dom = false;
+    bool huge_pages = false;
+    number_format numbers;
+    svg_options options;
+    bool write_tiles = false;
+    tile_options tiles;
+    std::vector<std::string> plan_files;
+    plan_legs legs = plan_legs::both;
+    std::string plan_directory;
+    std::string plan_expression;
+    std::string expression_file;
+    std::string ordered_directory;
+    std::size_t manipulators = 0;
+    std::string partition_directory;
+    partition_options partition;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            // 0 uses every core
+            threads = resolve_thread_count(std::stoul(argv[++i]));
+        } else if (arg == "--no-cache") {
+            use_cache = false;
+        } else if (arg == "--dom") {
+            use_dom = true;
+        } else if (arg == "--huge-pages") {
+            // Backs the --dom tree with transparent huge pages
+            huge_pages = true;
+        } else if (arg == "--use") {
+            options.mode = svg_mode::symbols;
+        } else if (arg == "--mirror-cl") {
+            options.mode = svg_mode::symbols;
+            options.mirror_cl = true;
+        } else if (arg == "--paths") {
+            options.mode = svg_mode::paths;
+        } else if (arg == "--no-numbers") {
+            options.tube_numbers = false;
+        } else if (arg == "--tiles" && i + 1 < argc) {
+            // Also writes a pyramid of tiles for pan and zoom viewers
+            write_tiles = true;
+            tiles.directory = argv[++i];
+        } else if (arg == "--max-zoom" && i + 1 < argc) {
+            tiles.max_zoom = std::stoi(argv[++i]);
+        } else if (arg == "--plan" && i + 1 < argc) {
+            // Colors the tubes of an inspection plan, may be repeated
+            plan_files.push_back(argv[++i]);
+        } else if (arg == "--all-plans" && i + 1 < argc) {
+            // Also writes tubesheet_<plan>.svg for every plan in a directory
+            plan_directory = argv[++i];
+        } else if (arg == "--plan-expr" && i + 1 < argc) {
+            // Set algebra over the --plan plans, e.g. "P3 - P4", drawn in
+            // place of them
+            plan_expression = argv[++i];
+        } else if (arg == "--expr-out" && i + 1 < argc) {
+            // Writes the result of --plan-expr as a plan
+            expression_file = argv[++i];
+        } else if (arg == "--order-plans" && i + 1 < argc) {
+            // Writes the --plan plans reordered for less probe travel
+            ordered_directory = argv[++i];
+        } else if (arg == "--partition" && i + 1 < argc) {
+            // Splits the plan tubes, all tubes without --plan, between N
+            // manipulators and draws their plans in place of them
+            const char *count = argv[++i];
+            const char *end = count + std::strlen(count);
+            auto result = std::from_chars(count, end, manipulators);
+            if (result.ec != std::errc() || result.ptr != end
+                    || manipulators < 1) {
+                std::cerr << "Invalid --partition: " << count
+                        << ", expected a number of manipulators from 1\n";
+                return 1;
+            }
+        } else if (arg == "--partition-out" && i + 1 < argc) {
+            // Writes the plans of --partition
+            partition_directory = argv[++i];
+        } else if (arg == "--probe-time" && i + 1 < argc) {
+            // Seconds per tube for --partition
+            partition.probe_time = std::stod(argv[++i]);
+        } else if (arg == "--travel-speed" && i + 1 < argc) {
+            // Inches per second for --partition
+            partition.travel_speed = std::stod(argv[++i]);
+        } else if (arg == "--plan-leg" && i + 1 < argc) {
+            std::string leg = argv[++i];
+            if (leg == "hl") {
+                legs = plan_legs::hl;
+            } else if (leg == "cl") {
+                legs = plan_legs::cl;
+            } else if (leg == "both") {
+                legs = plan_legs::both;
+            } else {
+                std::cerr << "Unknown --plan-leg: " << leg
+                        << ", expected hl, cl or both\n";
+                return 1;
+            }
+        } else if (arg == "--precision" && i + 1 < argc) {
+            // Decimals of the coordinates, shortest round trip if not given
+            numbers = number_format(std::stoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown option: " << arg << '\n';
+            std::cerr << "Usage: " << argv[0] << "\n"
+                    "    [--threads N] [--no-cache] [--dom [--huge-pages]] [--precision N]\n"
+                    "    [--use] [--mirror-cl] [--paths [--no-numbers]]\n"
+                    "    [--tiles DIR [--max-zoom N]]\n"
+                    "    [--plan FILE]... [--all-plans DIR] [--plan-leg hl|cl|both]\n"
+                    "    [--plan-expr EXPR [--expr-out FILE]] [--order-plans DIR]\n"
+                    "    [--partition N [--partition-out DIR] [--probe-time S]\n"
+                    "        [--travel-speed V]]\n";
+            return 1;
         }
     }
-}
-
-void add_dashed_line(rapidxml::xml_node<char> *parent_node, float x1, float y1,
-        float x2, float y2) {
-    auto doc = parent_node->document();
-    auto line_node = doc->allocate_node(rapidxml::node_element, "line");
-    append_attributes(*doc, line_node, { { "x1", std::to_string(x1) }, { "y1",
-            std::to_string(y1) }, { "x2", std::to_string(x2) }, { "y2",
-            std::to_string(y2) }, { "stroke", "gray" },
-            { "stroke-width", "0.02" }, { "stroke-dasharray", "0.2, 0.1" }, });
-
-    parent_node->append_node(line_node);
-}
 
-rapidxml::xml_node<char>* add_label(rapidxml::xml_node<char> *parent_node,
-        float x, float y, const char *label) {
-    auto doc = parent_node->document();
-    auto label_node = doc->allocate_node(rapidxml::node_element, "text",
-            doc->allocate_string(label));
-
-    append_attributes(*doc, label_node, { { "x", std::to_string(x) }, { "y",
-            std::to_string(y) }, { "class", "label" }, });
-
-    return label_node;
-}
-
-std::string read_tube_specs(std::string par) {
-
-    io::CSVReader<3, io::trim_chars<' ', '\t'>, io::no_quote_escape<';'>> in(
-            "tube_specs.csv");
-    in.read_header(io::ignore_extra_column, "Dato", "Valor", "Unidad");
-    std::string dato, valor, unidad;
-    while (in.read_row(dato, valor, unidad)) {
-        std::transform(dato.begin(), dato.end(), dato.begin(), ::toupper);
-        if (dato == par) {
-            return valor;
-        }
-    }
-    return ("");
-}
+    // Parse the CSV files, or load them from the binary cache next to them
+    tubesheet_sources sources = read_tubesheet_sources("tubesheet.csv",
+            "tube_specs.csv", threads, use_cache);
+    const tube_specs &specs = sources.specs;
+    float calle_ancha = specs.calle_ancha;
 
-rapidxml::xml_node<char>* add_tube(const rapidxml::xml_node<char> &parent_node,
-        float x, float y, float radius, std::string id,
-        const std::string &x_label, const std::string &y_label) {
-    auto doc = parent_node.document();
-    auto tube_group_node = doc->allocate_node(rapidxml::node_element, "g");
-    append_attributes(*doc, tube_group_node,
-            { { "id", doc->allocate_string(id.c_str()) },
-                    { "data-col", x_label }, { "data-row", y_label }
-
-            });
-
-    auto tube_node = doc->allocate_node(rapidxml::node_element, "circle");
-    append_attributes(*doc, tube_node, { { "cx", std::to_string(x) }, { "cy",
-            std::to_string(y) }, { "r", std::to_string(radius) }, { "class",
-            "tube" }, });
-
-    auto tooltip_node = doc->allocate_node(rapidxml::node_element, "title");
-    tooltip_node->value(
-            doc->allocate_string(
-                    (std::string("Col=") + x_label + " Row=" + y_label).c_str()));
-    tube_group_node->append_node(tooltip_node);
-    tube_group_node->append_node(tube_node);
-    auto number_node = doc->allocate_node(rapidxml::node_element, "text",
-            doc->allocate_string(id.substr(2).c_str()));
-    //number_node->value();
-    append_attributes(*doc, number_node, { { "class", "tube_num" }, { "x",
-            std::to_string(x) }, { "y", std::to_string(y) }, });
-
-    tube_group_node->append_node(number_node);
-    return tube_group_node;
-
-}
-
-int main() {
-    float tube_od = std::stof(read_tube_specs("TUBE_OD"));
-    float tube_r = tube_od / 2;
-
-    float calle_ancha = std::stof(read_tube_specs("CALLE_ANCHA"));
-
-    int margin_x = 1;
-    int margin_y = 1;
-
-    // Parse the CSV file to extract the data for each tube
-    std::map<std::string, tube> tubes;
-    std::map<std::string, float> x_labels;
-    std::map<std::string, float> y_labels;
-    io::CSVReader<7, io::trim_chars<' ', '\t'>, io::no_quote_escape<';'>> in(
-            "tubesheet.csv");
-    in.read_header(io::ignore_extra_column, "x_label", "y_label", "cl_x",
-            "cl_y", "hl_x", "hl_y", "tube_id");
-    std::string x_label, y_label;
-    float cl_x, cl_y, hl_x, hl_y;
-    std::string tube_id;
-    while (in.read_row(x_label, y_label, cl_x, cl_y, hl_x, hl_y, tube_id)) {
-        tubes.insert( { std::string(std::string("hl") + tube_id.substr(5)), {
-                x_label, y_label, "hl", hl_x, hl_y + (calle_ancha / 2) } });
-        tubes.insert( { std::string(std::string("cl") + tube_id.substr(5)), {
-                x_label, y_label, "cl", cl_x + 1.25f,
-                -(cl_y + (calle_ancha / 2)) } });
-
-        x_labels[x_label] = hl_x;
-        y_labels[y_label] = hl_y;
-
-    }
-
-    // Search for max x and y distances
-    auto min_y_it = std::min_element(tubes.begin(), tubes.end(),
-            [](auto a, auto b) {
-                return a.second.y < b.second.y;
-            });
-    float min_y = (*min_y_it).second.y;
-    std::cout << "absolute min Y :" << min_y << '\n';
+    tubesheet sheet = make_tubesheet(sources.rows, calle_ancha);
 
     // Search for max x and y distances
-    auto max_x_it = std::max_element(tubes.begin(), tubes.end(),
-            [](auto a, auto b) {
-                return a.second.x < b.second.x;
-            });
-    float max_x = (*max_x_it).second.x;
-    std::cout << "absolute max X :" << max_x << '\n';
-
-    auto max_y_it = std::max_element(tubes.begin(), tubes.end(),
-            [](auto a, auto b) {
-                return a.second.y < b.second.y;
-            });
-    float max_y = (*max_y_it).second.y;
-    std::cout << "absolute max Y :" << max_y << '\n';
+    tubesheet_extent extent = extent_of(sheet.tubes);
+    std::cout << "absolute min Y :" << extent.min_y << '\n';
+    std::cout << "absolute max X :" << extent.max_x << '\n';
+    std::cout << "absolute max Y :" << extent.max_y << '\n';
 
-    // Create the SVG document
-    rapidxml::xml_document<char> doc;
-    auto svg_node = doc.allocate_node(rapidxml::node_element, "svg");
-
-    append_attributes(doc, svg_node,
-            { { "xmlns", "http://www.w3.org/2000/svg" }, { "version", "1.1" }, {
-                    "id", "tubesheet_svg" }, { "height", "auto" }, { "width",
-                    "auto" }, { "viewBox", "-" + std::to_string(margin_x) + " "
-                    + std::to_string(-margin_y + std::floor(min_y)) + " "
-                    + std::to_string(std::ceil(max_x) + margin_x) + " "
-                    + std::to_string(std::ceil(2 * max_y) + margin_y) } });
-
-    auto style_node = doc.allocate_node(rapidxml::node_element, "style");
-    append_attributes(doc, style_node, { { "type", "text/css" } });
-
-    style_node->value(
-            ".tube {stroke: black; stroke-width: 0.02; fill: white;} "
-                    ".tube_num { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: black;}"
-                    ".label { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: red;}");
-
-    svg_node->append_node(style_node);
-    doc.append_node(svg_node);
-
-    add_dashed_line(svg_node, -margin_x, 0, std::ceil(max_x) + margin_x, 0);
-    add_dashed_line(svg_node, 0, -margin_y + std::floor(min_y), 0,
-            std::ceil(max_y) + margin_y);
-
-    for (auto [label, coord] : x_labels) {
+    for (auto [label, coord] : sheet.x_labels) {
         std::cout << "labels coord X: " << label << " : " << coord << "\n";
-
-        auto label_x = add_label(svg_node, coord, -margin_y * 0.75,
-                label.c_str());
-        append_attributes(doc, label_x,
-                { { "transform", "rotate(270," + std::to_string(coord) + ", -"
-                        + std::to_string(margin_y * 0.75) + ")" }, });
-        svg_node->append_node(label_x);
     }
-
-    for (auto [label, coord] : y_labels) {
+    for (auto [label, coord] : sheet.y_labels) {
         std::cout << "labels coord Y: " << label << " : " << coord << "\n";
-
-        auto label_y_cl = add_label(svg_node, -margin_x * 0.75,
-                -(coord + calle_ancha / 2), label.c_str());
-        svg_node->append_node(label_y_cl);
-
-        auto label_y_hl = add_label(svg_node, -margin_x * 0.75,
-                coord + calle_ancha / 2, label.c_str());
-        svg_node->append_node(label_y_hl);
-
     }
 
-    // Create an SVG circle element for each tube in the CSV data
-    for (const auto &tube_pair : tubes) {
-        auto tube = tube_pair.second;
+    options.threads = threads;
+
+    // Inspection plans are joined to the tubes by tube number and drawn in
+    // the same pass as the tubes
+    std::vector<insp_plan> plans;
+    std::vector<plan_match> matches;
+    auto report_plan = [](const insp_plan &plan, const plan_match &match) {
+        std::cout << "plan " << plan.name << ": " << plan.size() << " tubes, "
+                << match.tubes.size() << " drawn, " << match.unknown
+                << " unknown, " << match.mislabeled << " with other ROW/COL\n";
+    };
+    for (const auto &plan_file : plan_files) {
+        plans.push_back(read_insp_plan(plan_file.c_str()));
+        matches.push_back(match_plan(plans.back(), sheet.tubes, legs));
+        report_plan(plans.back(), matches.back());
+    }
+    if (!ordered_directory.empty()) {
+        // Travel is measured on the leg the plans are for, hl for both
+        tube_leg leg = legs == plan_legs::cl ? tube_leg::cl : tube_leg::hl;
+        std::vector<insp_plan> ordered = plans;
+        std::vector<plan_route_report> routes(plans.size());
+        parallel_for(plans.size(), threads, [&](std::size_t p) {
+            routes[p] = order_plan(ordered[p], sheet.tubes, leg);
+        });
+        std::filesystem::create_directories(ordered_directory);
+        for (std::size_t p = 0; p < plans.size(); ++p) {
+            std::string name = ordered_directory + "/" + plans[p].name + ".csv";
+            write_insp_plan(name.c_str(), ordered[p]);
+            const plan_route_report &route = routes[p];
+            std::cout << "plan " << plans[p].name << ": travel "
+                    << route.before << " -> " << route.after << " ("
+                    << (route.before > 0 ?
+                            100 * (route.before - route.after) / route.before : 0)
+                    << "% less), written to " << name << '\n';
+        }
+    }
 
-        auto tube_node = add_tube(*svg_node, tube.x, tube.y, tube_r,
-                tube_pair.first, tube.x_label, tube.y_label);
-        svg_node->append_node(tube_node);
+    if (!plan_expression.empty()) {
+        std::vector<named_tube_set> sets;
+        for (std::size_t p = 0; p < plans.size(); ++p) {
+            sets.push_back( { plans[p].name, plan_tube_set(matches[p],
+                    sheet.tubes) });
+        }
+        // ~ and ALL are over the tube ends of the --plan-leg legs only
+        tube_set universe = leg_tube_set(sheet.tubes, legs);
+        tube_set result = evaluate_plan_expression(plan_expression, sets,
+                universe);
+        insp_plan result_plan = make_insp_plan("result", result, sheet.tubes);
+        std::cout << plan_expression << ": " << result.count() << " of "
+                << universe.count() << " tube ends, " << result_plan.size()
+                << " tubes\n";
+        if (!expression_file.empty()) {
+            write_insp_plan(expression_file.c_str(), result_plan);
+        }
+        plan_match result_match;
+        result_match.tubes = result.indices();
+        plans.assign(1, std::move(result_plan));
+        matches.assign(1, std::move(result_match));
+    }
+    if (manipulators > 0) {
+        tube_set target(sheet.tubes.size(), plans.empty());
+        for (const auto &match : matches) {
+            target |= plan_tube_set(match, sheet.tubes);
+        }
+        tube_leg leg = legs == plan_legs::cl ? tube_leg::cl : tube_leg::hl;
+        manipulator_strips strips = make_manipulator_strips(specs, sheet.tubes,
+                manipulators);
+        partition.threads = threads;
+        plan_partition split = partition_tubes(target, sheet.tubes, leg, strips,
+                "Partition", partition);
+        std::cout << "partition over " << manipulators << " manipulators: "
+                << "makespan " << split.makespan << " s, estimated "
+                << split.estimated_makespan << " s\n";
+        if (!partition_directory.empty()) {
+            std::filesystem::create_directories(partition_directory);
+        }
+        plans.clear();
+        matches.clear();
+        for (std::size_t k = 0; k < split.plans.size(); ++k) {
+            const manipulator_load &load = split.loads[k];
+            std::cout << "plan " << split.plans[k].name << ": " << load.tubes
+                    << " tubes, travel " << load.travel << ", " << load.time
+                    << " s";
+            if (!partition_directory.empty()) {
+                std::string name = partition_directory + "/"
+                        + split.plans[k].name + ".csv";
+                write_insp_plan(name.c_str(), split.plans[k]);
+                std::cout << ", written to " << name;
+            }
+            std::cout << '\n';
+            plans.push_back(std::move(split.plans[k]));
+            matches.push_back(match_plan(plans.back(), sheet.tubes,
+                    leg == tube_leg::cl ? plan_legs::cl : plan_legs::hl));
+        }
+    }
+    tube_overlay overlay;
+    if (!plans.empty()) {
+        overlay = make_plan_overlay(plans, matches, sheet.tubes);
+        options.overlay = &overlay;
+    }
 
+    float offset_x;
+    if (options.mirror_cl && options.overlay) {
+        std::cout << "plans are drawn per tube, the cl leg is not mirrored\n";
+    } else if (options.mirror_cl && !cl_mirrors_hl(sheet.tubes, offset_x)) {
+        std::cout << "cl leg is not a mirror of the hl leg, drawing it tube by tube\n";
     }
 
     // Write the SVG document to a file
     std::ofstream file("tubesheet.svg");
-    file << doc;
+    if (use_dom) {
+        // Builds the whole tree first, for when it has to be modified before
+        // it is printed
+        rapidxml::xml_document<char> doc;
+        if (huge_pages) {
+            doc.set_allocator(huge_page_allocate, huge_page_free);
+        }
+        // One block for the whole tree instead of one per 64 KiB
+        std::size_t estimate = estimate_dom_pool_size(sheet);
+        doc.reserve(estimate);
+        svg_dom_writer writer(doc, numbers);
+        write_tubesheet_svg(writer, sheet, specs, extent, options);
+        std::cout << "pool bytes saved by sharing values: "
+                << writer.saved_pool_bytes() << '\n';
+        std::cout << "pool high-water mark: " << doc.allocated_size()
+                << " bytes, estimate " << estimate << " bytes, "
+                << doc.dynamic_block_count() << " dynamic blocks\n";
+        rapidxml::print_buffered(file, doc);
+    } else {
+        svg_stream_writer writer(file, numbers);
+        write_tubesheet_svg(writer, sheet, specs, extent, options);
+    }
     file.close();
 
+    if (options.mode != svg_mode::groups) {
+        // The drawing has no ids or labels per tube, scripts use this instead
+        std::ofstream index("tubesheet.json");
+        write_tube_index(index, sheet.tubes, specs.tube_od / 2, numbers);
+    }
+
+    if (!plan_directory.empty()) {
+        // One drawing per plan, spliced from a single rendering of the sheet
+        std::vector<plan_drawing> drawings = write_plan_drawings(sheet, specs,
+                extent, list_plan_files(plan_directory), legs, numbers,
+                options, threads);
+        for (const auto &drawing : drawings) {
+            report_plan(drawing.plan, drawing.match);
+            std::cout << "    written to " << drawing.file_name << '\n';
+        }
+    }
+
+    if (write_tiles) {
+        tiles.threads = threads;
+        tiles.numbers = numbers;
+        tile_report report = write_tile_pyramid(sheet, specs, extent, tiles);
+        std::cout << "tiles: " << report.written << " written, "
+                << report.empty << " empty, zoom 0-" << report.max_zoom
+                << ", largest " << report.largest_bytes << " bytes\n";
+    }
+
     return 0;
 }
+catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+}
@@ -0,0 +1,64 @@
+#ifndef OPEN_INDEX_H
+#define OPEN_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open addressing index over items stored elsewhere, e.g. in columns: every
+// slot holds the index + 1 of an item or 0 if it is free. Items are told
+// apart by a 64 bit key, which callers compare themselves.
+class open_index {
+public:
+    static const std::size_t npos = std::size_t(-1);
+
+    bool empty() const {
+        return slots.empty();
+    }
+
+    // Linear probing; returns the slot holding the item with the key, for
+    // which matches(i) holds, or the free slot where it would go.
+    template<class Matches>
+    std::size_t slot_of(std::uint64_t key, Matches matches) const {
+        std::size_t mask = slots.size() - 1;
+        std::size_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while (slots[slot] != 0 && !matches(slots[slot] - 1)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // The item in a slot, npos if it is free
+    std::size_t item(std::size_t slot) const {
+        return std::size_t(slots[slot]) - 1;
+    }
+
+    void set(std::size_t slot, std::size_t item) {
+        slots[slot] = item + 1;
+    }
+
+    // Makes room for `items` items, keeping the index at most half full.
+    // The `count` items already indexed are put back through key_of(i).
+    template<class KeyOf>
+    void reserve(std::size_t items, std::size_t count, KeyOf key_of) {
+        if (2 * items <= slots.size()) {
+            return;
+        }
+        std::size_t slot_count = std::max<std::size_t>( { 64, 2 * items,
+                2 * slots.size() });
+        std::size_t power_of_two = 1;
+        while (power_of_two < slot_count) {
+            power_of_two *= 2;
+        }
+        slots.assign(power_of_two, 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            set(slot_of(key_of(i), [](std::size_t) { return false; }), i);
+        }
+    }
+
+private:
+    std::vector<std::uint32_t> slots;
+};
+
+#endif
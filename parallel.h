@@ -0,0 +1,64 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Number of worker threads for a requested count, 0 meaning one per core.
+inline unsigned resolve_thread_count(unsigned requested) {
+    if (requested == 0) {
+        requested = std::thread::hardware_concurrency();
+    }
+    return requested ? requested : 1;
+}
+
+// Calls fn(i) for every i in [0, count) on up to `threads` threads, the
+// calling thread included. Indices are handed out in increasing order; if
+// any call throws, the exception of the lowest failing index is rethrown
+// once all workers have stopped.
+template<class Fn>
+void parallel_for(std::size_t count, unsigned threads, Fn fn) {
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> errors(count);
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < count && !failed; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif
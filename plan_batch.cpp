@@ -0,0 +1,58 @@
+#include "plan_batch.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "parallel.h"
+
+std::vector<std::string> list_plan_files(const std::string &directory) {
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".csv") {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<plan_drawing> write_plan_drawings(const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const std::vector<std::string> &plan_files, plan_legs legs,
+        const number_format &numbers, const svg_options &options,
+        unsigned threads) {
+    // Style, axes, labels and every tube as they are without a plan
+    bool splice = options.mode == svg_mode::groups;
+    tubesheet_base base;
+    if (splice) {
+        base = render_tubesheet_base(sheet, specs, extent, numbers);
+    }
+
+    std::vector<plan_drawing> drawings(plan_files.size());
+    parallel_for(plan_files.size(), threads, [&](std::size_t p) {
+        plan_drawing &drawing = drawings[p];
+        drawing.plan = read_insp_plan(plan_files[p].c_str());
+        drawing.match = match_plan(drawing.plan, sheet.tubes, legs);
+        tube_overlay overlay = make_plan_overlay( { drawing.plan },
+                { drawing.match }, sheet.tubes);
+
+        drawing.file_name = "tubesheet_" + drawing.plan.name + ".svg";
+        std::ofstream file(drawing.file_name);
+        if (splice) {
+            write_tubesheet_variant(file, base, overlay);
+        } else {
+            // The plans are already spread over the threads
+            svg_options plan_options = options;
+            plan_options.overlay = &overlay;
+            plan_options.threads = 1;
+            svg_stream_writer writer(file, numbers);
+            write_tubesheet_svg(writer, sheet, specs, extent, plan_options);
+        }
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Can not write " + drawing.file_name);
+        }
+    });
+    return drawings;
+}
@@ -0,0 +1,34 @@
+#ifndef PLAN_BATCH_H
+#define PLAN_BATCH_H
+
+#include <string>
+#include <vector>
+#include "insp_plan.h"
+#include "svg_writer.h"
+#include "tube_specs.h"
+#include "tube_table.h"
+#include "tubesheet_svg.h"
+
+// The *.csv files of a directory, sorted by name
+std::vector<std::string> list_plan_files(const std::string &directory);
+
+struct plan_drawing {
+    insp_plan plan;
+    plan_match match;
+    // "tubesheet_InspPlan1_M_1.svg"
+    std::string file_name;
+};
+
+// Draws the tubesheet once per plan in the mode of options, each with that
+// plan's tubes colored as --plan does; the overlay of options is replaced.
+// Plans are read and drawn on up to `threads` threads. In groups mode the
+// drawing without plan is rendered once and the plans are spliced into it,
+// the other modes draw every plan in full. Throws std::runtime_error if a
+// drawing can not be written.
+std::vector<plan_drawing> write_plan_drawings(const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const std::vector<std::string> &plan_files, plan_legs legs,
+        const number_format &numbers, const svg_options &options,
+        unsigned threads);
+
+#endif
@@ -0,0 +1,126 @@
+#include "plan_expr.h"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+// Recursive descent, one function per precedence level
+class expression_parser {
+public:
+    expression_parser(const std::string &text,
+            const std::vector<named_tube_set> &plans,
+            const tube_set &universe) :
+            text(text), plans(plans), universe(universe) {
+    }
+
+    tube_set parse() {
+        tube_set result = parse_union();
+        skip_space();
+        if (position != text.size()) {
+            fail("unexpected \"" + text.substr(position, 1) + "\"");
+        }
+        return result;
+    }
+
+private:
+    const std::string &text;
+    const std::vector<named_tube_set> &plans;
+    const tube_set &universe;
+    std::size_t position = 0;
+
+    [[noreturn]] void fail(const std::string &message) const {
+        throw std::runtime_error("Plan expression \"" + text + "\", column "
+                + std::to_string(position + 1) + ": " + message);
+    }
+
+    void skip_space() {
+        while (position < text.size()
+                && std::isspace(static_cast<unsigned char>(text[position]))) {
+            ++position;
+        }
+    }
+
+    bool take(char c) {
+        skip_space();
+        if (position < text.size() && text[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    tube_set parse_union() {
+        tube_set result = parse_intersection();
+        for (;;) {
+            if (take('|')) {
+                result |= parse_intersection();
+            } else if (take('-')) {
+                result -= parse_intersection();
+            } else {
+                return result;
+            }
+        }
+    }
+
+    tube_set parse_intersection() {
+        tube_set result = parse_complement();
+        while (take('&')) {
+            result &= parse_complement();
+        }
+        return result;
+    }
+
+    tube_set parse_complement() {
+        if (take('~')) {
+            return universe - parse_complement();
+        }
+        return parse_operand();
+    }
+
+    tube_set parse_operand() {
+        if (take('(')) {
+            tube_set result = parse_union();
+            if (!take(')')) {
+                fail("missing \")\"");
+            }
+            return result;
+        }
+
+        skip_space();
+        std::size_t start = position;
+        while (position < text.size()
+                && (std::isalnum(static_cast<unsigned char>(text[position]))
+                        || text[position] == '_' || text[position] == '.')) {
+            ++position;
+        }
+        std::string name = text.substr(start, position - start);
+        if (name.empty()) {
+            fail("expected a plan");
+        }
+        if (name == "ALL") {
+            return universe;
+        }
+        for (const auto &plan : plans) {
+            if (plan.name == name) {
+                return plan.tubes;
+            }
+        }
+        if (name.size() > 1 && name.size() <= 10 && name[0] == 'P'
+                && name.find_first_not_of("0123456789", 1) == std::string::npos) {
+            std::size_t n = std::stoul(name.substr(1));
+            if (n >= 1 && n <= plans.size()) {
+                return plans[n - 1].tubes;
+            }
+        }
+        position = start;
+        fail("unknown plan \"" + name + "\"");
+    }
+};
+
+}
+
+tube_set evaluate_plan_expression(const std::string &expression,
+        const std::vector<named_tube_set> &plans, const tube_set &universe) {
+    return expression_parser(expression, plans, universe).parse();
+}
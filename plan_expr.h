@@ -0,0 +1,29 @@
+#ifndef PLAN_EXPR_H
+#define PLAN_EXPR_H
+
+#include <string>
+#include <vector>
+#include "tube_set.h"
+
+// A tube set that can be named in plan expressions
+struct named_tube_set {
+    std::string name;
+    tube_set tubes;
+};
+
+// Evaluates a set expression over plans, within a universe of tubes such as
+// the tubes of one leg:
+//     ALL          every tube of the universe
+//     P<n>         the n-th plan, counting from 1
+//     <name>       the plan of that name, e.g. InspPlan3_M_2
+//     ~a           the tubes of the universe not in a
+//     a & b        intersection
+//     a | b        union
+//     a - b        difference
+// ~ binds tightest, then &, then | and - from left to right; parentheses
+// group. Throws std::runtime_error for a malformed expression or an unknown
+// plan.
+tube_set evaluate_plan_expression(const std::string &expression,
+        const std::vector<named_tube_set> &plans, const tube_set &universe);
+
+#endif
@@ -0,0 +1,283 @@
+#include "plan_partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include "parallel.h"
+#include "plan_route.h"
+
+namespace {
+
+// Length of a short path through n random points in an area, per
+// sqrt(n * area) (Beardwood, Halton and Hammersley)
+const double path_constant = 0.7124;
+
+// Sweeps of pairwise balancing per search, a bound that is never reached in
+// practice
+const unsigned max_sweeps = 1000;
+
+// Searches, each with the travel estimates corrected by the routes of the
+// one before
+const unsigned calibration_rounds = 3;
+
+// The target tubes sorted along the strip axis, with the time of any run of
+// them in O(1): the run's extent along the axis are its ends, the extent
+// across it comes from sparse tables of minima and maxima.
+class run_costs {
+public:
+    // Factor on the estimated travel of each manipulator
+    std::vector<double> travel_scale;
+
+    run_costs(std::vector<float> along, std::vector<float> across,
+            std::size_t manipulators, const partition_options &options) :
+            travel_scale(manipulators, 1), along(std::move(along)),
+            options(options) {
+        std::size_t n = this->along.size();
+        min_across.push_back(across);
+        max_across.push_back(std::move(across));
+        for (std::size_t width = 2; width <= n; width *= 2) {
+            const std::vector<float> &min_below = min_across.back();
+            const std::vector<float> &max_below = max_across.back();
+            std::vector<float> min_level(n - width + 1);
+            std::vector<float> max_level(n - width + 1);
+            for (std::size_t i = 0; i + width <= n; ++i) {
+                min_level[i] = std::min(min_below[i], min_below[i + width / 2]);
+                max_level[i] = std::max(max_below[i], max_below[i + width / 2]);
+            }
+            min_across.push_back(std::move(min_level));
+            max_across.push_back(std::move(max_level));
+        }
+    }
+
+    // Seconds for manipulator k to probe the tubes [begin, end) and travel
+    // between them
+    double time(std::size_t k, std::size_t begin, std::size_t end) const {
+        std::size_t n = end - begin;
+        return options.probe_time * n
+                + travel_scale[k] * travel(begin, end) / options.travel_speed;
+    }
+
+    // The estimate for random points, but never shorter than the longer side
+    // of the bounding box, which a path through a thin run has to cover
+    double travel(std::size_t begin, std::size_t end) const {
+        std::size_t n = end - begin;
+        if (n < 2) {
+            return 0;
+        }
+        std::size_t level = 0;
+        while (std::size_t(2) << level <= n) {
+            ++level;
+        }
+        std::size_t last = end - (std::size_t(1) << level);
+        double width = double(along[end - 1]) - along[begin];
+        double height = double(std::max(max_across[level][begin],
+                max_across[level][last]))
+                - std::min(min_across[level][begin], min_across[level][last]);
+        return std::max(path_constant * std::sqrt(n * width * height),
+                std::max(width, height));
+    }
+
+private:
+    std::vector<float> along;
+    // Level l holds the minimum or maximum of the 2^l values from each index
+    std::vector<std::vector<float>> min_across;
+    std::vector<std::vector<float>> max_across;
+    const partition_options &options;
+};
+
+// Manipulator k gets the sorted tubes [cuts[k], cuts[k + 1])
+struct split {
+    std::vector<std::size_t> cuts;
+    double makespan;
+};
+
+double makespan_of(const std::vector<std::size_t> &cuts, const run_costs &costs) {
+    double makespan = 0;
+    for (std::size_t k = 0; k + 1 < cuts.size(); ++k) {
+        makespan = std::max(makespan, costs.time(k, cuts[k], cuts[k + 1]));
+    }
+    return makespan;
+}
+
+// Moves every inner cut to where its two runs take the most even time, the
+// left one growing and the right one shrinking as the cut moves right, until
+// a sweep no longer lowers the makespan
+split balance(std::vector<std::size_t> cuts, const std::vector<std::size_t> &min_cut,
+        const std::vector<std::size_t> &max_cut, const run_costs &costs) {
+    double makespan = makespan_of(cuts, costs);
+    for (unsigned sweep = 0; sweep < max_sweeps; ++sweep) {
+        for (std::size_t k = 1; k + 1 < cuts.size(); ++k) {
+            std::size_t low = std::max(min_cut[k], cuts[k - 1]);
+            std::size_t high = std::min(max_cut[k], cuts[k + 1]);
+            auto pair_time = [&](std::size_t cut) {
+                return std::max(costs.time(k - 1, cuts[k - 1], cut),
+                        costs.time(k, cut, cuts[k + 1]));
+            };
+            // The first cut where the left run takes at least as long
+            std::size_t first = low;
+            std::size_t last = high;
+            while (first < last) {
+                std::size_t middle = first + (last - first) / 2;
+                if (costs.time(k - 1, cuts[k - 1], middle)
+                        >= costs.time(k, middle, cuts[k + 1])) {
+                    last = middle;
+                } else {
+                    first = middle + 1;
+                }
+            }
+            std::size_t best = first;
+            if (first > low && pair_time(first - 1) <= pair_time(first)) {
+                best = first - 1;
+            }
+            if (pair_time(best) < pair_time(cuts[k])) {
+                cuts[k] = best;
+            }
+        }
+        double balanced = makespan_of(cuts, costs);
+        if (!(balanced < makespan)) {
+            break;
+        }
+        makespan = balanced;
+    }
+    return {std::move(cuts), makespan};
+}
+
+}
+
+manipulator_strips make_manipulator_strips(const tube_specs &specs,
+        const tube_table &tubes, std::size_t count, float overlap) {
+    manipulator_strips strips;
+    float width = specs.ancho_x_max - specs.ancho_x_min;
+    float height = specs.alto_y_max - specs.alto_y_min;
+    strips.along_x = width >= height;
+    const std::vector<float> &along = strips.along_x ? tubes.x : tubes.y;
+    float length = strips.along_x ? width : height;
+
+    float center = 0;
+    if (!along.empty()) {
+        auto [lowest, highest] = std::minmax_element(along.begin(), along.end());
+        center = (*lowest + *highest) / 2;
+    }
+    float strip = length / count;
+    float reach = std::clamp(overlap, 0.0f, 0.5f) * strip;
+    float start = center - length / 2;
+    const float open = std::numeric_limits<float>::infinity();
+    for (std::size_t k = 0; k < count; ++k) {
+        strips.low.push_back(k == 0 ? -open : start + k * strip - reach);
+        strips.high.push_back(
+                k + 1 == count ? open : start + (k + 1) * strip + reach);
+    }
+    return strips;
+}
+
+plan_partition partition_tubes(const tube_set &target, const tube_table &tubes,
+        tube_leg leg, const manipulator_strips &strips, const std::string &name,
+        const partition_options &options) {
+    std::size_t count = strips.size();
+    const std::vector<float> &along = strips.along_x ? tubes.x : tubes.y;
+    const std::vector<float> &across = strips.along_x ? tubes.y : tubes.x;
+
+    // The target tubes of the leg along the strip axis
+    std::vector<std::uint32_t> sorted;
+    for (std::uint32_t i : target.indices()) {
+        if (tubes.leg[i] == leg) {
+            sorted.push_back(i);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(),
+            [&](std::uint32_t a, std::uint32_t b) {
+                if (along[a] != along[b]) {
+                    return along[a] < along[b];
+                }
+                if (across[a] != across[b]) {
+                    return across[a] < across[b];
+                }
+                return a < b;
+            });
+    std::size_t n = sorted.size();
+    std::vector<float> sorted_along(n);
+    std::vector<float> sorted_across(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        sorted_along[k] = along[sorted[k]];
+        sorted_across[k] = across[sorted[k]];
+    }
+
+    // Cut k ends the run of manipulator k - 1: it leaves every tube below the
+    // reach of manipulator k to the ones before and no tube beyond the reach
+    // of manipulator k - 1 to it
+    std::vector<std::size_t> min_cut(count + 1, 0);
+    std::vector<std::size_t> max_cut(count + 1, n);
+    for (std::size_t k = 1; k < count; ++k) {
+        min_cut[k] = std::lower_bound(sorted_along.begin(), sorted_along.end(),
+                strips.low[k]) - sorted_along.begin();
+        max_cut[k] = std::upper_bound(sorted_along.begin(), sorted_along.end(),
+                strips.high[k - 1]) - sorted_along.begin();
+    }
+    run_costs costs(std::move(sorted_along), std::move(sorted_across), count,
+            options);
+
+    // Independent searches, each from its own seed so the best split does not
+    // depend on the number of threads
+    auto search = [&]() {
+        std::vector<split> splits(std::max(options.restarts, 1u));
+        parallel_for(splits.size(), options.threads, [&](std::size_t r) {
+            std::mt19937 random(r);
+            std::vector<std::size_t> cuts(count + 1, 0);
+            cuts[count] = n;
+            for (std::size_t k = 1; k < count; ++k) {
+                std::size_t low = std::max(min_cut[k], cuts[k - 1]);
+                cuts[k] = std::uniform_int_distribution<std::size_t>(low,
+                        max_cut[k])(random);
+            }
+            splits[r] = balance(std::move(cuts), min_cut, max_cut, costs);
+        });
+        return *std::min_element(splits.begin(), splits.end(),
+                [](const split &a, const split &b) {
+                    return a.makespan < b.makespan;
+                });
+    };
+
+    auto route = [&](const split &best) {
+        plan_partition partition;
+        partition.estimated_makespan = best.makespan;
+        partition.plans.resize(count);
+        partition.loads.resize(count);
+        parallel_for(count, options.threads, [&](std::size_t k) {
+            tube_set run(tubes.size());
+            for (std::size_t i = best.cuts[k]; i < best.cuts[k + 1]; ++i) {
+                run.insert(sorted[i]);
+            }
+            insp_plan &plan = partition.plans[k];
+            plan = make_insp_plan(name + "_M_" + std::to_string(k + 1), run,
+                    tubes);
+            plan_route_report route = order_plan(plan, tubes, leg);
+            partition.loads[k] = { plan.size(), route.after, options.probe_time
+                    * plan.size() + route.after / options.travel_speed };
+        });
+        partition.makespan = 0;
+        for (const auto &load : partition.loads) {
+            partition.makespan = std::max(partition.makespan, load.time);
+        }
+        return partition;
+    };
+
+    // The estimate is for random points, a lattice of tubes is longer to
+    // travel and by how much depends on the shape of the run
+    plan_partition partition;
+    for (unsigned round = 0; round < calibration_rounds; ++round) {
+        split best = search();
+        plan_partition routed = route(best);
+        for (std::size_t k = 0; k < count; ++k) {
+            double estimate = costs.travel(best.cuts[k], best.cuts[k + 1]);
+            if (estimate > 0) {
+                costs.travel_scale[k] = routed.loads[k].travel / estimate;
+            }
+        }
+        if (round == 0 || routed.makespan < partition.makespan) {
+            partition = std::move(routed);
+        }
+    }
+    return partition;
+}
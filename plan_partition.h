@@ -0,0 +1,72 @@
+#ifndef PLAN_PARTITION_H
+#define PLAN_PARTITION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "insp_plan.h"
+#include "tube_set.h"
+#include "tube_specs.h"
+#include "tube_table.h"
+
+// The reach of the manipulators: strips side by side across the sheet, along
+// x or along y. Strip k reaches from low[k] to high[k] on that axis and over
+// the whole sheet on the other one.
+struct manipulator_strips {
+    bool along_x = true;
+    std::vector<float> low;
+    std::vector<float> high;
+
+    std::size_t size() const {
+        return low.size();
+    }
+};
+
+// Splits the sheet extents of the specs (ANCHO_X_MIN..ANCHO_X_MAX by
+// ALTO_Y_MIN..ALTO_Y_MAX) into count strips across their longer side. Every
+// strip reaches overlap of a strip width into its neighbours, at most half,
+// so a tube is in reach of one or two manipulators. The spec file measures
+// the extents from another origin, they are centered on the tubes; the outer
+// sides of the first and last strip are open.
+manipulator_strips make_manipulator_strips(const tube_specs &specs,
+        const tube_table &tubes, std::size_t count, float overlap = 0.25f);
+
+struct partition_options {
+    // Seconds to probe one tube
+    double probe_time = 1;
+    // Tubesheet units (inches) the probe travels per second
+    double travel_speed = 1;
+    // Searches from random starting splits, run on up to `threads` threads
+    unsigned restarts = 32;
+    unsigned threads = 1;
+};
+
+struct manipulator_load {
+    std::size_t tubes;
+    // Of the plan as ordered by order_plan()
+    double travel;
+    // Probing plus travel, in seconds
+    double time;
+};
+
+struct plan_partition {
+    // "<name>_M_1" .. "<name>_M_<count>", each in travel order
+    std::vector<insp_plan> plans;
+    std::vector<manipulator_load> loads;
+    // Of the split as searched, with the estimated travel, and of the
+    // ordered plans
+    double estimated_makespan;
+    double makespan;
+};
+
+// Splits the tubes of the target set on one leg between the manipulators so
+// that the last one finishes as early as possible. Every manipulator gets
+// the tubes of a run along the strip axis within its reach; the cuts between
+// the runs are balanced pairwise from random starts, with the travel of a
+// run estimated from its size and bounding box. The plans are then ordered
+// for travel and timed again.
+plan_partition partition_tubes(const tube_set &target, const tube_table &tubes,
+        tube_leg leg, const manipulator_strips &strips, const std::string &name,
+        const partition_options &options);
+
+#endif
@@ -0,0 +1,332 @@
+#include "plan_route.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "tube_grid.h"
+
+namespace {
+
+// Moves have to gain more than this to count, which stops rounding from
+// cycling between equal paths
+const double min_gain = 1e-7;
+
+// Candidates per tube for 2-opt and Or-opt
+const std::size_t neighbour_count = 8;
+
+// An open path with a fixed first point, as an order of the points and the
+// position of every point in it
+class route {
+public:
+    route(const std::vector<float> &x, const std::vector<float> &y) :
+            x(x), y(y), grid(x, y, cell_size(x, y)) {
+    }
+
+    double distance(std::uint32_t a, std::uint32_t b) const {
+        double dx = double(x[a]) - x[b];
+        double dy = double(y[a]) - y[b];
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    double length() const {
+        double total = 0;
+        for (std::size_t k = 1; k < order.size(); ++k) {
+            total += distance(order[k - 1], order[k]);
+        }
+        return total;
+    }
+
+    void nearest_neighbour_path() {
+        std::size_t n = x.size();
+        std::vector<char> visited(n, false);
+        order.assign(1, 0);
+        visited[0] = true;
+        for (std::size_t k = 1; k < n; ++k) {
+            std::uint32_t last = order.back();
+            std::size_t next = grid.nearest(x[last], y[last],
+                    [&](std::uint32_t i) { return !visited[i]; });
+            visited[next] = true;
+            order.push_back(next);
+        }
+        update_positions(0, n);
+    }
+
+    void find_neighbours() {
+        std::size_t n = x.size();
+        std::size_t count = std::min(neighbour_count, n - 1);
+        neighbours.resize(n * count);
+        per_point = count;
+        for (std::uint32_t a = 0; a < n; ++a) {
+            std::uint32_t *found = &neighbours[a * count];
+            for (std::size_t k = 0; k < count; ++k) {
+                found[k] = grid.nearest(x[a], y[a], [&](std::uint32_t i) {
+                    return i != a && std::find(found, found + k, i) == found + k;
+                });
+            }
+        }
+    }
+
+    // Tries both kinds of moves around every point. A point whose moves
+    // gain nothing is only looked at again once a move changes one of its
+    // edges ("don't look bits"), so the work follows the improvements
+    // instead of sweeping the whole path until nothing changes.
+    void improve() {
+        queued.assign(order.size(), true);
+        queue.assign(order.rbegin(), order.rend());
+        while (!queue.empty()) {
+            std::uint32_t a = queue.back();
+            queue.pop_back();
+            queued[a] = false;
+            if (two_opt(a) || or_opt(a)) {
+                wake(a);
+            }
+        }
+    }
+
+    const std::vector<std::uint32_t>& points() const {
+        return order;
+    }
+
+private:
+    const std::vector<float> &x;
+    const std::vector<float> &y;
+    tube_grid grid;
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint32_t> position;
+    std::vector<std::uint32_t> neighbours;
+    std::size_t per_point = 0;
+    std::vector<std::uint32_t> queue;
+    std::vector<char> queued;
+
+    void wake(std::uint32_t a) {
+        if (!queued[a]) {
+            queued[a] = true;
+            queue.push_back(a);
+        }
+    }
+
+    // Wakes the points at the ends of the edges around positions
+    void wake_around(std::initializer_list<std::size_t> positions) {
+        for (std::size_t k : positions) {
+            for (std::size_t p = k > 0 ? k - 1 : 0;
+                    p <= k + 1 && p < order.size(); ++p) {
+                wake(order[p]);
+            }
+        }
+    }
+
+    // About two points per cell
+    static float cell_size(const std::vector<float> &x,
+            const std::vector<float> &y) {
+        auto [min_x, max_x] = std::minmax_element(x.begin(), x.end());
+        auto [min_y, max_y] = std::minmax_element(y.begin(), y.end());
+        float area = std::max(*max_x - *min_x, 1e-3f)
+                * std::max(*max_y - *min_y, 1e-3f);
+        return std::sqrt(2 * area / x.size());
+    }
+
+    void update_positions(std::size_t begin, std::size_t end) {
+        position.resize(order.size());
+        for (std::size_t k = begin; k < end; ++k) {
+            position[order[k]] = k;
+        }
+    }
+
+    void reverse(std::size_t first, std::size_t last) {
+        std::reverse(order.begin() + first, order.begin() + last + 1);
+        update_positions(first, last + 1);
+    }
+
+    // Replaces an edge of a and one of a neighbour by two others, reversing
+    // the path between them
+    bool two_opt(std::uint32_t a) {
+        std::size_t n = order.size();
+        std::size_t i = position[a];
+        for (std::size_t k = 0; k < per_point; ++k) {
+            std::uint32_t b = neighbours[a * per_point + k];
+            std::size_t j = position[b];
+            double gain = 0;
+            std::size_t first = 0;
+            std::size_t last = 0;
+            if (i + 1 < n && j + 1 < n) {
+                // (a, a+) (b, b+) -> (a, b) (a+, b+)
+                std::uint32_t a_next = order[i + 1];
+                std::uint32_t b_next = order[j + 1];
+                gain = distance(a, a_next) + distance(b, b_next)
+                        - distance(a, b) - distance(a_next, b_next);
+                first = std::min(i, j) + 1;
+                last = std::max(i, j);
+            } else if (i + 1 < n && j + 1 == n) {
+                // (a, a+) -> (a, last), the tail turned around
+                gain = distance(a, order[i + 1]) - distance(a, b);
+                first = i + 1;
+                last = j;
+            }
+            if ((gain <= min_gain || first >= last) && i > 0 && j > 0) {
+                // (a-, a) (b-, b) -> (a-, b-) (a, b)
+                std::uint32_t a_prev = order[i - 1];
+                std::uint32_t b_prev = order[j - 1];
+                gain = distance(a_prev, a) + distance(b_prev, b)
+                        - distance(a, b) - distance(a_prev, b_prev);
+                first = std::min(i, j);
+                last = std::max(i, j) - 1;
+            }
+            if (gain > min_gain && first < last) {
+                reverse(first, last);
+                wake_around( { first, last });
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves a run of up to three points that starts or ends at a elsewhere,
+    // in either direction
+    bool or_opt(std::uint32_t a) {
+        std::size_t i = position[a];
+        for (std::size_t length = 1; length <= 3; ++length) {
+            if (i >= 1 && i + length <= order.size() && move_segment(i, length)) {
+                return true;
+            }
+            if (length > 1 && i >= length
+                    && move_segment(i + 1 - length, length)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool move_segment(std::size_t i, std::size_t length) {
+        std::size_t n = order.size();
+        std::size_t end = i + length;
+        std::uint32_t first = order[i];
+        std::uint32_t last = order[end - 1];
+        std::uint32_t prev = order[i - 1];
+        double removed = distance(prev, first);
+        if (end < n) {
+            removed += distance(last, order[end])
+                    - distance(prev, order[end]);
+        }
+
+        // Insert behind a neighbour c of either end, before its successor
+        for (std::uint32_t end_point : { first, last }) {
+            for (std::size_t k = 0; k < per_point; ++k) {
+                std::uint32_t c = neighbours[end_point * per_point + k];
+                std::size_t j = position[c];
+                if ((j >= i - 1 && j < end)) {
+                    continue;
+                }
+                double added_forward;
+                double added_reversed;
+                if (j + 1 < n) {
+                    std::uint32_t d = order[j + 1];
+                    double gap = distance(c, d);
+                    added_forward = distance(c, first) + distance(last, d) - gap;
+                    added_reversed = distance(c, last) + distance(first, d) - gap;
+                } else {
+                    added_forward = distance(c, first);
+                    added_reversed = distance(c, last);
+                }
+                bool reversed = added_reversed < added_forward;
+                double added = reversed ? added_reversed : added_forward;
+                if (removed - added > min_gain) {
+                    std::size_t to = relocate(i, length, j, reversed);
+                    wake_around( { i - 1, i, to, to + length - 1 });
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Moves order[i, i + length) behind position j, returns its new position
+    std::size_t relocate(std::size_t i, std::size_t length, std::size_t j,
+            bool reversed) {
+        std::size_t begin;
+        std::size_t end;
+        if (j < i) {
+            std::rotate(order.begin() + j + 1, order.begin() + i,
+                    order.begin() + i + length);
+            begin = j + 1;
+            end = i + length;
+            if (reversed) {
+                std::reverse(order.begin() + j + 1, order.begin() + j + 1 + length);
+            }
+        } else {
+            std::rotate(order.begin() + i, order.begin() + i + length,
+                    order.begin() + j + 1);
+            begin = i;
+            end = j + 1;
+            if (reversed) {
+                std::reverse(order.begin() + j + 1 - length, order.begin() + j + 1);
+            }
+        }
+        update_positions(begin, end);
+        return j < i ? j + 1 : j + 1 - length;
+    }
+};
+
+double travel(const std::vector<float> &x, const std::vector<float> &y) {
+    double total = 0;
+    for (std::size_t k = 1; k < x.size(); ++k) {
+        total += std::hypot(double(x[k]) - x[k - 1], double(y[k]) - y[k - 1]);
+    }
+    return total;
+}
+
+}
+
+plan_route_report order_plan(insp_plan &plan, const tube_table &tubes,
+        tube_leg leg) {
+    plan_route_report report { 0, 0, 0 };
+
+    // The plan lines with a tube, in file order
+    std::vector<std::size_t> lines;
+    std::vector<std::size_t> unplaced;
+    std::vector<float> x;
+    std::vector<float> y;
+    for (std::size_t k = 0; k < plan.size(); ++k) {
+        std::size_t i = tubes.find(leg, plan.tube_number[k]);
+        if (i == tube_table::npos) {
+            unplaced.push_back(k);
+            continue;
+        }
+        lines.push_back(k);
+        x.push_back(tubes.x[i]);
+        y.push_back(tubes.y[i]);
+    }
+    report.unplaced = unplaced.size();
+    report.before = report.after = travel(x, y);
+    if (lines.size() < 3) {
+        return report;
+    }
+
+    route path(x, y);
+    path.nearest_neighbour_path();
+    path.find_neighbours();
+    path.improve();
+    report.after = path.length();
+    if (report.after >= report.before) {
+        // The file order was already as good
+        report.after = report.before;
+        return report;
+    }
+
+    insp_plan ordered;
+    ordered.name = plan.name;
+    auto append = [&](std::size_t k) {
+        ordered.row.push_back(plan.row[k]);
+        ordered.col.push_back(plan.col[k]);
+        ordered.tube_number.push_back(plan.tube_number[k]);
+    };
+    for (std::uint32_t point : path.points()) {
+        append(lines[point]);
+    }
+    for (std::size_t k : unplaced) {
+        append(k);
+    }
+    plan = std::move(ordered);
+    return report;
+}
@@ -0,0 +1,25 @@
+#ifndef PLAN_ROUTE_H
+#define PLAN_ROUTE_H
+
+#include <cstddef>
+#include "insp_plan.h"
+#include "tube_table.h"
+
+struct plan_route_report {
+    // Travel between consecutive tube centers, in the units of the tubesheet
+    double before;
+    double after;
+    // Plan lines whose tube is not in the table; they keep their order at
+    // the end of the plan
+    std::size_t unplaced;
+};
+
+// Reorders the plan into a short path over the centers of its tubes on one
+// leg, starting at its first tube: a nearest neighbour path improved with
+// 2-opt and Or-opt moves until neither finds a gain. Moves are only tried
+// between each tube and its nearest neighbours, found through a tube_grid,
+// which keeps plans of tens of thousands of tubes to seconds.
+plan_route_report order_plan(insp_plan &plan, const tube_table &tubes,
+        tube_leg leg);
+
+#endif
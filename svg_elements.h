@@ -0,0 +1,261 @@
+#ifndef SVG_ELEMENTS_H
+#define SVG_ELEMENTS_H
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "svg_writer.h"
+#include "tube_table.h"
+#include "tubesheet_svg.h"
+
+// Elements shared by the whole sheet drawing and its tiles, written through
+// either SVG writer
+
+// Room around the tubes for the row and column labels
+const int margin_x = 1;
+const int margin_y = 1;
+
+const char tubesheet_css[] =
+        ".tube {stroke: black; stroke-width: 0.02; fill: white;} "
+                ".tube_num { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: black;}"
+                ".label { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: red;}";
+
+inline void append_number(std::string &text, const number_format &numbers,
+        float value) {
+    char buffer[svg_number_size];
+    text.append(buffer, numbers.format(buffer, value));
+}
+
+// "x y width height"
+inline std::string view_box_text(const svg_view_box &box,
+        const number_format &numbers) {
+    std::string text;
+    append_number(text, numbers, box.x);
+    text += ' ';
+    append_number(text, numbers, box.y);
+    text += ' ';
+    append_number(text, numbers, box.width);
+    text += ' ';
+    append_number(text, numbers, box.height);
+    return text;
+}
+
+// Appends a number to path data in its shortest form: without the zero
+// before the point of a fraction, and after a space only where the number
+// before would otherwise run into it
+inline void append_path_number(std::string &d, std::string_view number) {
+    bool negative = number[0] == '-';
+    if (negative) {
+        number.remove_prefix(1);
+    }
+    if (number.size() > 1 && number[0] == '0' && number[1] == '.') {
+        number.remove_prefix(1);
+    }
+    if (negative) {
+        d += '-';
+    } else if (!d.empty() && (std::isdigit(static_cast<unsigned char>(d.back()))
+            || d.back() == '.')) {
+        d += ' ';
+    }
+    d += number;
+}
+
+// Path data of circles of one radius, each drawn by two half circle arcs
+// from its leftmost point and back. A circle in the same row as the one
+// before is moved to relative to that one, by the exact difference of their
+// printed x values, which is shorter than its position.
+class circle_path {
+public:
+    std::string d;
+
+    circle_path(number_cache &numbers, float r) :
+            numbers(&numbers) {
+        to_left = "m";
+        append_path_number(to_left, numbers.text(-r));
+        append_path_number(to_left, "0");
+        for (float diameter : { 2 * r, -2 * r }) {
+            arcs += 'a';
+            append_path_number(arcs, numbers.text(r));
+            append_path_number(arcs, numbers.text(r));
+            arcs += " 0 1 0";
+            append_path_number(arcs, numbers.text(diameter));
+            append_path_number(arcs, "0");
+        }
+    }
+
+    // Room for count circles
+    void reserve(std::size_t count) {
+        d.reserve(count * (to_left.size() + arcs.size() + 16));
+    }
+
+    void add(float x, float y) {
+        if (!d.empty() && y == last_y) {
+            d += 'm';
+            append_offset(last_x, x);
+            append_path_number(d, "0");
+        } else {
+            d += 'M';
+            append_path_number(d, numbers->text(x));
+            append_path_number(d, numbers->text(y));
+            d += to_left;
+        }
+        d += arcs;
+        last_x = x;
+        last_y = y;
+    }
+
+private:
+    number_cache *numbers;
+    std::string to_left;
+    std::string arcs;
+    float last_x = 0;
+    float last_y = 0;
+
+    static int decimals_of(std::string_view number) {
+        std::size_t point = number.find('.');
+        return point == std::string_view::npos ? 0 : number.size() - point - 1;
+    }
+
+    void append_offset(float from, float to) {
+        char from_text[svg_number_size];
+        std::string_view text = numbers->text(from);
+        std::size_t from_size = text.copy(from_text, sizeof(from_text));
+        std::string_view to_text = numbers->text(to);
+        double from_value;
+        double to_value;
+        std::from_chars(from_text, from_text + from_size, from_value);
+        std::from_chars(to_text.data(), to_text.data() + to_text.size(),
+                to_value);
+        // Rounding to the decimals of the two drops the error of the
+        // subtraction
+        number_format offset(std::max(
+                decimals_of(std::string_view(from_text, from_size)),
+                decimals_of(to_text)));
+        char buffer[svg_number_size];
+        append_path_number(d, std::string_view(buffer,
+                offset.format(buffer, float(to_value - from_value))));
+    }
+};
+
+// The style sheet, with the rules of the overlay classes if there is one
+template<class Writer>
+void add_style(Writer &out, std::string_view css,
+        const tube_overlay *overlay = nullptr) {
+    out.start_element("style");
+    out.attribute("type", "text/css");
+    if (overlay) {
+        out.text(std::string(css) + overlay->css);
+    } else {
+        out.text(css);
+    }
+    out.end_element();
+}
+
+template<class Writer>
+void add_dashed_line(Writer &out, float x1, float y1, float x2, float y2) {
+    out.start_element("line");
+    out.attributes( { { "stroke", "gray" }, { "stroke-dasharray", "0.2, 0.1" },
+            { "stroke-width", "0.02" } });
+    out.attribute("x1", x1);
+    out.attribute("x2", x2);
+    out.attribute("y1", y1);
+    out.attribute("y2", y2);
+    out.end_element();
+}
+
+// Leaves the element open for further attributes
+template<class Writer>
+void start_label(Writer &out, float x, float y) {
+    out.start_element("text");
+    out.attribute("class", "label");
+    out.attribute("x", x);
+    out.attribute("y", y);
+}
+
+template<class Writer>
+void add_center_lines(Writer &out, const tubesheet_extent &extent) {
+    add_dashed_line(out, -margin_x, 0, std::ceil(extent.max_x) + margin_x, 0);
+    add_dashed_line(out, 0, -margin_y + std::floor(extent.min_y), 0,
+            std::ceil(extent.max_y) + margin_y);
+}
+
+// Row and column labels. With a clip box only the labels anchored inside it.
+template<class Writer>
+void add_labels(Writer &out, const tubesheet &sheet, float calle_ancha,
+        const svg_view_box *clip = nullptr) {
+    auto visible = [clip](float x, float y) {
+        return !clip || (x >= clip->x && x <= clip->x + clip->width
+                && y >= clip->y && y <= clip->y + clip->height);
+    };
+
+    char number[svg_number_size];
+    std::string transform;
+    for (auto [label, coord] : sheet.x_labels) {
+        if (!visible(coord, -margin_y * 0.75)) {
+            continue;
+        }
+        start_label(out, coord, -margin_y * 0.75);
+        transform = "rotate(270,";
+        append_number(transform, out.numbers(), coord);
+        transform += ", ";
+        append_number(transform, out.numbers(), -margin_y * 0.75);
+        transform += ')';
+        out.attribute("transform", transform);
+        out.text(std::string_view(number, format_number(number, unsigned(label))));
+        out.end_element();
+    }
+
+    for (auto [label, coord] : sheet.y_labels) {
+        std::string_view text(number, format_number(number, unsigned(label)));
+        for (float y : { -(coord + calle_ancha / 2), coord + calle_ancha / 2 }) {
+            if (!visible(-margin_x * 0.75, y)) {
+                continue;
+            }
+            start_label(out, -margin_x * 0.75, y);
+            out.text(text);
+            out.end_element();
+        }
+    }
+}
+
+template<class Writer>
+void add_tube(Writer &out, float x, float y, float radius, std::string_view id,
+        unsigned col, unsigned row, std::string_view circle_class = "tube") {
+    char x_label[svg_number_size];
+    char y_label[svg_number_size];
+    std::string_view col_text(x_label, format_number(x_label, col));
+    std::string_view row_text(y_label, format_number(y_label, row));
+
+    out.start_element("g");
+    out.attributes( { { "data-col", col_text }, { "data-row", row_text }, {
+            "id", id } });
+
+    char title[2 * svg_number_size + 16];
+    int title_size = std::snprintf(title, sizeof(title), "Col=%.*s Row=%.*s",
+            int(col_text.size()), x_label, int(row_text.size()), y_label);
+    out.start_element("title");
+    out.text(std::string_view(title, title_size));
+    out.end_element();
+
+    out.start_element("circle");
+    out.attribute("class", circle_class);
+    out.attribute("cx", x);
+    out.attribute("cy", y);
+    out.attribute("r", radius);
+    out.end_element();
+
+    out.start_element("text");
+    out.attribute("class", "tube_num");
+    out.attribute("x", x);
+    out.attribute("y", y);
+    out.text(id.substr(2));
+    out.end_element();
+
+    out.end_element();
+}
+
+#endif
@@ -0,0 +1,308 @@
+#include "svg_writer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+std::size_t number_format::format(char (&buffer)[svg_number_size],
+        float value) const {
+    char *end = buffer + svg_number_size;
+#ifdef __cpp_lib_to_chars
+    if (decimals == shortest) {
+        end = std::to_chars(buffer, end, value, std::chars_format::fixed).ptr;
+    } else {
+        end = std::to_chars(buffer, end, value, std::chars_format::fixed,
+                decimals).ptr;
+    }
+#else
+    if (decimals == shortest) {
+        // Enough digits to read back as the same float, the trailing zeros
+        // are removed below
+        end = buffer + std::snprintf(buffer, svg_number_size, "%.9g", value);
+    } else {
+        end = buffer + std::snprintf(buffer, svg_number_size, "%.*f", decimals,
+                value);
+    }
+#endif
+    if (std::find(buffer, end, '.') != end && std::find(buffer, end, 'e') == end) {
+        while (end[-1] == '0') {
+            --end;
+        }
+        if (end[-1] == '.') {
+            --end;
+        }
+    }
+    // Rounding can leave "-0"
+    if (end - buffer == 2 && buffer[0] == '-' && buffer[1] == '0') {
+        buffer[0] = '0';
+        --end;
+    }
+    return end - buffer;
+}
+
+std::size_t format_number(char (&buffer)[svg_number_size], unsigned value) {
+    return std::to_chars(buffer, buffer + svg_number_size, value).ptr - buffer;
+}
+
+number_cache::entry* number_cache::find_or_add(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (!index.empty()) {
+        std::size_t found = index.item(slot_of(bits));
+        if (found != open_index::npos) {
+            return &entries[found];
+        }
+    }
+    if (entries.size() >= max_entries) {
+        return nullptr;
+    }
+
+    index.reserve(entries.size() + 1, entries.size(),
+            [&](std::size_t i) { return entries[i].bits; });
+    std::size_t size = numbers.format(scratch, value);
+    entries.push_back( { bits, std::uint32_t(texts.size()), std::uint32_t(size),
+            nullptr });
+    texts.append(scratch, size);
+    index.set(slot_of(bits), entries.size() - 1);
+    return &entries.back();
+}
+
+std::string_view number_cache::text(float value) {
+    entry *e = find_or_add(value);
+    if (e) {
+        return text(*e);
+    }
+    return std::string_view(scratch, numbers.format(scratch, value));
+}
+
+std::size_t number_cache::slot_of(std::uint32_t bits) const {
+    return index.slot_of(bits,
+            [&](std::size_t i) { return entries[i].bits == bits; });
+}
+
+void* huge_page_allocate(std::size_t size) {
+    void *memory = nullptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    const std::size_t huge_page_size = 2 << 20;
+    if (size >= huge_page_size / 2) {
+        std::size_t rounded = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+        memory = std::aligned_alloc(huge_page_size, rounded);
+        if (memory) {
+            // Only advice, the memory is usable without huge pages
+            madvise(memory, rounded, MADV_HUGEPAGE);
+        }
+    }
+#endif
+    if (!memory) {
+        memory = std::malloc(size);
+    }
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void huge_page_free(void *pointer) {
+    std::free(pointer);
+}
+
+const char* string_interner::intern(std::string_view s) {
+    auto found = strings.find(s);
+    if (found != strings.end()) {
+        saved += pool_size(s.size());
+        return found->data();
+    }
+    const char *copy = pool.allocate_string(s.data(), s.size());
+    strings.insert(std::string_view(copy, s.size()));
+    return copy;
+}
+
+svg_stream_writer::svg_stream_writer(std::ostream &out,
+        number_format numbers, std::size_t buffer_size) :
+        out(&out), cache(numbers), buffer_size(buffer_size) {
+    buffer.reserve(buffer_size + 4096);
+}
+
+svg_stream_writer::svg_stream_writer(std::size_t depth, number_format numbers) :
+        out(nullptr), cache(numbers), buffer_size(0), base_depth(depth) {
+}
+
+svg_stream_writer::~svg_stream_writer() {
+    flush();
+}
+
+void svg_stream_writer::start_element(const char *name) {
+    start_child();
+    indent(depth());
+    buffer += '<';
+    buffer += name;
+    open.push_back( { name, false });
+    in_start_tag = true;
+}
+
+void svg_stream_writer::attribute(const char *name, std::string_view value) {
+    buffer += ' ';
+    buffer += name;
+    // Same quoting as rapidxml: single quotes if the value has a double one,
+    // the other quote character is not escaped
+    bool single = value.find('"') != std::string_view::npos;
+    char quote = single ? '\'' : '"';
+    buffer += '=';
+    buffer += quote;
+    escape(value, single ? '"' : '\'');
+    buffer += quote;
+}
+
+void svg_stream_writer::attribute(const char *name, float value) {
+    safe_attribute(name, cache.text(value));
+}
+
+void svg_stream_writer::attribute(const char *name, unsigned value) {
+    char number[svg_number_size];
+    safe_attribute(name, std::string_view(number, format_number(number, value)));
+}
+
+void svg_stream_writer::safe_attribute(const char *name,
+        std::string_view value) {
+    buffer += ' ';
+    buffer += name;
+    buffer += "=\"";
+    buffer += value;
+    buffer += '"';
+}
+
+void svg_stream_writer::attributes(std::initializer_list<svg_attribute> list) {
+    for (const auto &attr : list) {
+        attribute(attr.name, attr.value);
+    }
+}
+
+void svg_stream_writer::text(std::string_view value) {
+    if (value.empty()) {
+        return;
+    }
+    close_start_tag();
+    escape(value, 0);
+}
+
+void svg_stream_writer::end_element() {
+    open_element element = open.back();
+    open.pop_back();
+    if (in_start_tag) {
+        buffer += "/>";
+        in_start_tag = false;
+    } else {
+        if (element.has_content) {
+            indent(depth());
+        }
+        buffer += "</";
+        buffer += element.name;
+        buffer += '>';
+    }
+    buffer += '\n';
+    if (buffer.size() >= buffer_size) {
+        flush();
+    }
+}
+
+void svg_stream_writer::end_document() {
+    buffer += '\n';
+    flush();
+    if (out) {
+        out->flush();
+    }
+}
+
+void svg_stream_writer::append_fragment(std::string_view fragment) {
+    if (fragment.empty()) {
+        return;
+    }
+    start_child();
+    if (out && fragment.size() >= buffer_size) {
+        // Big fragments go to the stream without another copy
+        flush();
+        out->write(fragment.data(), fragment.size());
+        return;
+    }
+    buffer.append(fragment);
+    if (buffer.size() >= buffer_size) {
+        flush();
+    }
+}
+
+std::string svg_stream_writer::take_fragment() {
+    std::string fragment;
+    fragment.swap(buffer);
+    return fragment;
+}
+
+// Closes the start tag of the parent of a new child element
+void svg_stream_writer::start_child() {
+    if (!open.empty()) {
+        if (in_start_tag) {
+            close_start_tag();
+            buffer += '\n';
+        }
+        open.back().has_content = true;
+    }
+}
+
+void svg_stream_writer::close_start_tag() {
+    if (in_start_tag) {
+        buffer += '>';
+        in_start_tag = false;
+    }
+}
+
+void svg_stream_writer::indent(std::size_t depth) {
+    buffer.append(depth, '\t');
+}
+
+void svg_stream_writer::escape(std::string_view value, char noexpand) {
+    // Copies the runs between the characters that need an entity at once
+    const char *run = value.data();
+    const char *end = run + value.size();
+    for (const char *c = run; c != end; ++c) {
+        const char *entity;
+        switch (*c) {
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        case '\'':
+            entity = "&apos;";
+            break;
+        case '"':
+            entity = "&quot;";
+            break;
+        case '&':
+            entity = "&amp;";
+            break;
+        default:
+            continue;
+        }
+        if (*c == noexpand) {
+            continue;
+        }
+        buffer.append(run, c);
+        buffer += entity;
+        run = c + 1;
+    }
+    buffer.append(run, end);
+}
+
+void svg_stream_writer::flush() {
+    // Fragments stay in the buffer until they are taken
+    if (out) {
+        out->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
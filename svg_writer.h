@@ -0,0 +1,316 @@
+#ifndef SVG_WRITER_H
+#define SVG_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "inc/rapidxml-1.13/rapidxml.hpp"
+#include "open_index.h"
+
+// Both writers take the same calls: start_element, then its attributes, then
+// either a text value or child elements, then end_element. Attributes are
+// written in call order. Elements with neither text nor children are closed
+// with "/>". Element and attribute names are not copied, they have to outlive
+// the writer (string literals in practice).
+
+struct svg_attribute {
+    const char *name;
+    std::string_view value;
+};
+
+// Room for any float in fixed notation
+const std::size_t svg_number_size = 64;
+
+// How coordinates are printed: by default the shortest text that reads back
+// as the same float, otherwise rounded to a number of decimals. Trailing
+// zeros are dropped in both cases and the result does not depend on the
+// locale.
+class number_format {
+public:
+    static const int shortest = -1;
+    // More would not fit into svg_number_size for the largest floats
+    static const int max_precision = 20;
+
+    // A negative precision selects the shortest form
+    explicit number_format(int precision = shortest) :
+            decimals(precision < 0 ? shortest :
+                    precision < max_precision ? precision : max_precision) {
+    }
+
+    int precision() const {
+        return decimals;
+    }
+
+    // Returns the length of the text, which is not NUL terminated
+    std::size_t format(char (&buffer)[svg_number_size], float value) const;
+
+private:
+    int decimals;
+};
+
+// Formats value without allocating. Returns the length of the text, which is
+// not NUL terminated.
+std::size_t format_number(char (&buffer)[svg_number_size], unsigned value);
+
+// Formats every distinct float once. The x and y values of a tube lattice
+// repeat for every tube of a column or row, so almost every coordinate is a
+// lookup. Values are told apart by their bits, past max_entries distinct
+// values new ones are formatted without being kept.
+class number_cache {
+public:
+    static const std::size_t max_entries = 1 << 16;
+
+    struct entry {
+        std::uint32_t bits;
+        std::uint32_t offset;
+        std::uint32_t size;
+        // For the user of the cache, e.g. a copy of the text in a memory pool
+        const char *copy;
+    };
+
+    explicit number_cache(number_format numbers = number_format()) :
+            numbers(numbers) {
+    }
+
+    const number_format& format() const {
+        return numbers;
+    }
+
+    // The entry of value, added if it is new; nullptr if the cache is full.
+    // Entries move when new ones are added.
+    entry* find_or_add(float value);
+
+    std::string_view text(const entry &e) const {
+        return std::string_view(texts.data() + e.offset, e.size);
+    }
+
+    // The text of value, valid until the next call
+    std::string_view text(float value);
+
+private:
+    number_format numbers;
+    std::vector<entry> entries;
+    open_index index;
+    std::string texts;
+    char scratch[svg_number_size];
+
+    std::size_t slot_of(std::uint32_t bits) const;
+};
+
+// Writes the markup straight to a stream as it is produced, formatted exactly
+// like rapidxml's printer (tab indenting, one element per line). Memory use
+// is the buffer plus the names of the open elements.
+//
+// A fragment writer keeps the markup in memory instead, indented as if it
+// were nested depth elements deep. Fragments are written independently, e.g.
+// on other threads, and spliced into the document in order with
+// append_fragment(); the result is the same as writing them in place.
+class svg_stream_writer {
+public:
+    explicit svg_stream_writer(std::ostream &out,
+            number_format numbers = number_format(),
+            std::size_t buffer_size = 1 << 16);
+    // A fragment writer
+    explicit svg_stream_writer(std::size_t depth,
+            number_format numbers = number_format());
+    svg_stream_writer(const svg_stream_writer&) = delete;
+    svg_stream_writer& operator=(const svg_stream_writer&) = delete;
+    ~svg_stream_writer();
+
+    void start_element(const char *name);
+    void attribute(const char *name, std::string_view value);
+    void attribute(const char *name, float value);
+    void attribute(const char *name, unsigned value);
+    void attributes(std::initializer_list<svg_attribute> list);
+    void text(std::string_view value);
+    void end_element();
+
+    // Terminates the document and flushes it to the stream
+    void end_document();
+
+    // Nesting depth of the next element
+    std::size_t depth() const {
+        return base_depth + open.size();
+    }
+
+    // Adds the elements of a fragment written at depth() as children of the
+    // innermost open element
+    void append_fragment(std::string_view fragment);
+
+    // The markup of a fragment writer, which is left empty
+    std::string take_fragment();
+
+    // Bytes of markup a fragment writer holds
+    std::size_t fragment_size() const {
+        return buffer.size();
+    }
+
+    const number_format& numbers() const {
+        return cache.format();
+    }
+
+private:
+    struct open_element {
+        const char *name;
+        bool has_content;
+    };
+
+    // Null for fragment writers
+    std::ostream *out;
+    number_cache cache;
+    std::string buffer;
+    std::size_t buffer_size;
+    std::size_t base_depth = 0;
+    std::vector<open_element> open;
+    // The start tag of the innermost element still lacks its '>'
+    bool in_start_tag = false;
+
+    void start_child();
+    // For values known to need no escaping, numbers
+    void safe_attribute(const char *name, std::string_view value);
+    void close_start_tag();
+    void indent(std::size_t depth);
+    void escape(std::string_view value, char noexpand);
+    void flush();
+};
+
+// Allocation functions for rapidxml::memory_pool::set_allocator. Blocks of a
+// megabyte or more are aligned to 2 MiB and marked for transparent huge
+// pages where the system supports it, smaller ones come from malloc.
+void* huge_page_allocate(std::size_t size);
+void huge_page_free(void *pointer);
+
+// Bytes a rapidxml memory pool takes for an allocation of size bytes, which
+// is rounded up to the alignment
+inline std::size_t pool_size(std::size_t size) {
+    return (size + RAPIDXML_ALIGNMENT - 1) & ~(RAPIDXML_ALIGNMENT - 1);
+}
+
+// Stores every distinct string once in a rapidxml memory pool and returns the
+// same copy for all repeats. Counts the pool bytes the repeats did not take.
+class string_interner {
+public:
+    explicit string_interner(rapidxml::memory_pool<char> &pool) :
+            pool(pool) {
+    }
+
+    // The pooled copy of s, which is not NUL terminated
+    const char* intern(std::string_view s);
+
+    // Notes a repeat of a string the caller shared by itself
+    void count_shared(std::size_t size) {
+        saved += pool_size(size);
+    }
+
+    std::size_t saved_bytes() const {
+        return saved;
+    }
+
+    std::size_t size() const {
+        return strings.size();
+    }
+
+private:
+    rapidxml::memory_pool<char> &pool;
+    // The views point into the pool
+    std::unordered_set<std::string_view> strings;
+    std::size_t saved = 0;
+};
+
+// Builds the same markup as a rapidxml tree in doc, for callers that want to
+// change the tree before it is printed.
+class svg_dom_writer {
+public:
+    explicit svg_dom_writer(rapidxml::xml_document<char> &doc,
+            number_format numbers = number_format()) :
+            doc(doc), cache(numbers), strings(doc) {
+    }
+
+    void start_element(const char *name) {
+        auto node = doc.allocate_node(rapidxml::node_element, name);
+        parent()->append_node(node);
+        open.push_back(node);
+    }
+
+    // Every distinct value is copied into the document's memory pool once
+    // and shared by all attributes and texts that have it
+    void attribute(const char *name, std::string_view value) {
+        open.back()->append_attribute(
+                doc.allocate_attribute(name, pool_copy(value), 0,
+                        value.size()));
+    }
+
+    void attribute(const char *name, float value) {
+        number_cache::entry *e = cache.find_or_add(value);
+        if (!e) {
+            attribute(name, cache.text(value));
+            open.back()->last_attribute()->value_safe(true);
+            return;
+        }
+        if (!e->copy) {
+            e->copy = pool_copy(cache.text(*e));
+        } else {
+            strings.count_shared(e->size);
+        }
+        auto attr = doc.allocate_attribute(name, e->copy, 0, e->size);
+        attr->value_safe(true);
+        open.back()->append_attribute(attr);
+    }
+
+    // Numbers are marked as needing no escaping, the buffered printer copies
+    // them as they are
+    void attribute(const char *name, unsigned value) {
+        char buffer[svg_number_size];
+        attribute(name, std::string_view(buffer, format_number(buffer, value)));
+        open.back()->last_attribute()->value_safe(true);
+    }
+
+    void attributes(std::initializer_list<svg_attribute> list) {
+        for (const auto &attr : list) {
+            attribute(attr.name, attr.value);
+        }
+    }
+
+    void text(std::string_view value) {
+        open.back()->value(pool_copy(value), value.size());
+    }
+
+    void end_element() {
+        open.pop_back();
+    }
+
+    void end_document() {
+    }
+
+    const number_format& numbers() const {
+        return cache.format();
+    }
+
+    // Pool bytes saved by sharing repeated values
+    std::size_t saved_pool_bytes() const {
+        return strings.saved_bytes();
+    }
+
+private:
+    rapidxml::xml_document<char> &doc;
+    number_cache cache;
+    string_interner strings;
+    std::vector<rapidxml::xml_node<char>*> open;
+
+    rapidxml::xml_node<char>* parent() {
+        return open.empty() ? &doc : open.back();
+    }
+
+    char* pool_copy(std::string_view value) {
+        // rapidxml takes non-const pointers but does not write through them
+        return value.empty() ?
+                nullptr : const_cast<char*>(strings.intern(value));
+    }
+};
+
+#endif
@@ -0,0 +1,113 @@
+// Checks of evaluate_plan_expression() over the tube ends of one or both
+// legs. Exits with 1 and names the failed check if any fails.
+//
+// Build and run from the repository root with
+//     g++ -std=c++17 -O2 -I. -Iinc -o plan_expr_test tests/plan_expr_test.cpp
+//         plan_expr.cpp insp_plan.cpp tube_set.cpp tube_table.cpp
+//         tubesheet_csv.cpp -lpthread
+//     ./plan_expr_test
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "insp_plan.h"
+#include "plan_expr.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// Tubes 1 to 4 on both legs, hot leg first
+tube_table make_tubes() {
+    tube_table tubes;
+    for (tube_leg leg : { tube_leg::hl, tube_leg::cl }) {
+        for (std::uint32_t n = 1; n <= 4; ++n) {
+            tubes.add(leg, n, n, 1, float(n), leg == tube_leg::hl ? 1.0f : -1.0f);
+        }
+    }
+    return tubes;
+}
+
+std::vector<named_tube_set> plan_sets(const tube_table &tubes,
+        plan_legs legs) {
+    insp_plan plan;
+    plan.name = "InspPlan1_M_1";
+    plan.row = { 1 };
+    plan.col = { 1 };
+    plan.tube_number = { 1 };
+    return { { plan.name, plan_tube_set(match_plan(plan, tubes, legs),
+            tubes) } };
+}
+
+void complement_under_one_leg() {
+    tube_table tubes = make_tubes();
+    for (plan_legs legs : { plan_legs::hl, plan_legs::cl }) {
+        tube_leg side = legs == plan_legs::hl ? tube_leg::hl : tube_leg::cl;
+        tube_set universe = leg_tube_set(tubes, legs);
+        std::vector<named_tube_set> sets = plan_sets(tubes, legs);
+
+        tube_set all = evaluate_plan_expression("ALL", sets, universe);
+        check(all.count() == 4, "ALL holds the tube ends of the leg");
+
+        tube_set rest = evaluate_plan_expression("~P1", sets, universe);
+        check(rest.count() == 3, "~P1 holds the other tube ends of the leg");
+        bool on_leg = true;
+        for (std::uint32_t i : rest.indices()) {
+            on_leg = on_leg && tubes.leg[i] == side && tubes.number[i] != 1;
+        }
+        check(on_leg, "~P1 holds no tube of the other leg nor of P1");
+        check(make_insp_plan("result", rest, tubes).size() == 3,
+                "the plan of ~P1 lists 3 tubes");
+
+        tube_set twice = evaluate_plan_expression("~~P1", sets, universe);
+        check(twice.count() == 1 && twice.contains(sets[0].tubes.indices()[0]),
+                "~~P1 is P1");
+        check(evaluate_plan_expression("ALL - P1 | P1", sets, universe).count()
+                == 4, "ALL - P1 | P1 is ALL");
+    }
+}
+
+void complement_under_both_legs() {
+    tube_table tubes = make_tubes();
+    tube_set universe = leg_tube_set(tubes, plan_legs::both);
+    std::vector<named_tube_set> sets = plan_sets(tubes, plan_legs::both);
+    check(evaluate_plan_expression("ALL", sets, universe).count() == 8,
+            "ALL holds every tube end");
+    check(evaluate_plan_expression("~P1", sets, universe).count() == 6,
+            "~P1 holds both legs of the other tubes");
+}
+
+void malformed_expressions() {
+    tube_table tubes = make_tubes();
+    tube_set universe = leg_tube_set(tubes, plan_legs::hl);
+    std::vector<named_tube_set> sets = plan_sets(tubes, plan_legs::hl);
+    for (const char *expression : { "P1 &", "P2", "(P1", "P1 P1", "" }) {
+        bool thrown = false;
+        try {
+            evaluate_plan_expression(expression, sets, universe);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, expression);
+    }
+}
+
+}
+
+int main() {
+    complement_under_one_leg();
+    complement_under_both_legs();
+    malformed_expressions();
+    if (failures > 0) {
+        return 1;
+    }
+    std::printf("all plan expression checks passed\n");
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "tube_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+tube_grid::tube_grid(const tube_table &tubes, float cell_size) :
+        tube_grid(tubes.x, tubes.y, cell_size) {
+}
+
+tube_grid::tube_grid(const std::vector<float> &x, const std::vector<float> &y,
+        float cell_size) :
+        x(x), y(y), cell_size(cell_size) {
+    if (x.empty()) {
+        cell_start.assign(1, 0);
+        return;
+    }
+    auto [min_x, max_x] = std::minmax_element(x.begin(), x.end());
+    auto [min_y, max_y] = std::minmax_element(y.begin(), y.end());
+    origin_x = *min_x;
+    origin_y = *min_y;
+    columns = std::size_t((*max_x - origin_x) / cell_size) + 1;
+    rows = std::size_t((*max_y - origin_y) / cell_size) + 1;
+
+    // Counting sort of the tubes by cell, which keeps table order within
+    // every cell
+    std::vector<std::uint32_t> cell(x.size());
+    cell_start.assign(columns * rows + 1, 0);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        cell[i] = row_of(y[i]) * columns + column_of(x[i]);
+        ++cell_start[cell[i] + 1];
+    }
+    for (std::size_t c = 1; c < cell_start.size(); ++c) {
+        cell_start[c] += cell_start[c - 1];
+    }
+    std::vector<std::uint32_t> next(cell_start.begin(), cell_start.end() - 1);
+    items.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        items[next[cell[i]]++] = i;
+    }
+}
+
+std::size_t tube_grid::column_of(float at_x) const {
+    float column = std::floor((at_x - origin_x) / cell_size);
+    return column <= 0 ? 0 : std::min(std::size_t(column), columns - 1);
+}
+
+std::size_t tube_grid::row_of(float at_y) const {
+    float row = std::floor((at_y - origin_y) / cell_size);
+    return row <= 0 ? 0 : std::min(std::size_t(row), rows - 1);
+}
+
+void tube_grid::find(float min_x, float min_y, float max_x, float max_y,
+        std::vector<std::uint32_t> &found) const {
+    if (items.empty() || max_x < min_x || max_y < min_y) {
+        return;
+    }
+    std::size_t first = found.size();
+    std::size_t last_column = column_of(max_x);
+    std::size_t last_row = row_of(max_y);
+    for (std::size_t row = row_of(min_y); row <= last_row; ++row) {
+        for (std::size_t column = column_of(min_x); column <= last_column;
+                ++column) {
+            std::size_t c = row * columns + column;
+            for (std::uint32_t k = cell_start[c]; k < cell_start[c + 1]; ++k) {
+                std::uint32_t i = items[k];
+                if (x[i] >= min_x && x[i] <= max_x && y[i] >= min_y
+                        && y[i] <= max_y) {
+                    found.push_back(i);
+                }
+            }
+        }
+    }
+    std::sort(found.begin() + first, found.end());
+}
@@ -0,0 +1,98 @@
+#ifndef TUBE_GRID_H
+#define TUBE_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tube_table.h"
+
+// Uniform grid over the tube centers for rectangle and nearest neighbour
+// queries. The tubes of every cell are stored contiguously, in table order.
+// The coordinates are referenced, not copied.
+class tube_grid {
+public:
+    // cell_size is in the units of the tube coordinates; a few tubes per
+    // cell is about right
+    tube_grid(const tube_table &tubes, float cell_size);
+    // Over any points, e.g. the tubes of a plan
+    tube_grid(const std::vector<float> &x, const std::vector<float> &y,
+            float cell_size);
+
+    // Appends the indices of the tubes whose center lies in the rectangle,
+    // in increasing order
+    void find(float min_x, float min_y, float max_x, float max_y,
+            std::vector<std::uint32_t> &found) const;
+
+    // The tube nearest to (x, y) for which accept(i) holds, or npos. Rings
+    // of cells around the point are searched until no closer tube can
+    // follow.
+    template<class Accept>
+    std::size_t nearest(float x, float y, Accept accept) const;
+
+    static const std::size_t npos = std::size_t(-1);
+
+private:
+    const std::vector<float> &x;
+    const std::vector<float> &y;
+    float origin_x = 0;
+    float origin_y = 0;
+    float cell_size;
+    std::size_t columns = 0;
+    std::size_t rows = 0;
+    // The tubes of cell c are items[cell_start[c] .. cell_start[c + 1])
+    std::vector<std::uint32_t> cell_start;
+    std::vector<std::uint32_t> items;
+
+    std::size_t column_of(float at_x) const;
+    std::size_t row_of(float at_y) const;
+};
+
+template<class Accept>
+std::size_t tube_grid::nearest(float to_x, float to_y, Accept accept) const {
+    if (items.empty()) {
+        return npos;
+    }
+    long column = long(column_of(to_x));
+    long row = long(row_of(to_y));
+    long max_ring = long(std::max(columns, rows));
+    std::size_t best = npos;
+    float best_distance = 0;
+    for (long ring = 0; ring <= max_ring; ++ring) {
+        // Tubes in this ring and beyond are at least this far away, from a
+        // point inside the grid
+        if (best != npos && best_distance <= (ring - 1) * cell_size) {
+            break;
+        }
+        for (long r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= long(rows)) {
+                continue;
+            }
+            // Only the border cells of the ring are new
+            long step = r == row - ring || r == row + ring ? 1 : 2 * ring;
+            for (long c = column - ring; c <= column + ring; c += step) {
+                if (c < 0 || c >= long(columns)) {
+                    continue;
+                }
+                std::size_t cell = r * columns + c;
+                for (std::uint32_t k = cell_start[cell];
+                        k < cell_start[cell + 1]; ++k) {
+                    std::uint32_t i = items[k];
+                    if (!accept(i)) {
+                        continue;
+                    }
+                    float distance = std::hypot(x[i] - to_x, y[i] - to_y);
+                    if (best == npos || distance < best_distance
+                            || (distance == best_distance && i < best)) {
+                        best = i;
+                        best_distance = distance;
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "tube_index.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+template<class T, class Append>
+void append_array(std::string &json, const char *name,
+        const std::vector<T> &column, Append append) {
+    json += ",\"";
+    json += name;
+    json += "\":[";
+    for (std::size_t i = 0; i < column.size(); ++i) {
+        if (i != 0) {
+            json += ',';
+        }
+        append(i);
+    }
+    json += ']';
+}
+
+}
+
+void write_tube_index(std::ostream &out, const tube_table &tubes,
+        float radius, const number_format &numbers) {
+    number_cache cache(numbers);
+    char number[svg_number_size];
+    std::string json = "{\"radius\":";
+    json += cache.text(radius);
+
+    append_array(json, "id", tubes.number, [&](std::size_t i) {
+        json += '"';
+        json += leg_name(tubes.leg[i]);
+        json.append(number, format_number(number, tubes.number[i]));
+        json += '"';
+    });
+    append_array(json, "col", tubes.col, [&](std::size_t i) {
+        json.append(number, format_number(number, tubes.col[i]));
+    });
+    append_array(json, "row", tubes.row, [&](std::size_t i) {
+        json.append(number, format_number(number, tubes.row[i]));
+    });
+    append_array(json, "x", tubes.x, [&](std::size_t i) {
+        json += cache.text(tubes.x[i]);
+    });
+    append_array(json, "y", tubes.y, [&](std::size_t i) {
+        json += cache.text(tubes.y[i]);
+    });
+    json += "}\n";
+    out.write(json.data(), json.size());
+}
@@ -0,0 +1,16 @@
+#ifndef TUBE_INDEX_H
+#define TUBE_INDEX_H
+
+#include <ostream>
+#include "svg_writer.h"
+#include "tube_table.h"
+
+// Writes the tubes as a columnar JSON index, the sidecar of the symbols and
+// paths drawings, which have no ids or labels per tube. Scripts hit test a
+// pointer position against it:
+// {"radius":r,"id":["hl1",...],"col":[...],"row":[...],"x":[...],"y":[...]}
+// Coordinates are in the user units of the drawing.
+void write_tube_index(std::ostream &out, const tube_table &tubes,
+        float radius, const number_format &numbers);
+
+#endif
@@ -0,0 +1,167 @@
+#include "tube_set.h"
+
+#include <stdexcept>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TUBE_SET_HAS_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Word kernels: the scalar ones are what compilers vectorize for the
+// baseline target, the AVX2 ones are picked at run time where the CPU has
+// it. Popcount uses the POPCNT instruction where there is one.
+
+typedef void (*combine_func)(std::uint64_t*, const std::uint64_t*, std::size_t);
+typedef std::size_t (*count_func)(const std::uint64_t*, std::size_t);
+
+void or_scalar(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] |= b[i];
+    }
+}
+
+void and_scalar(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] &= b[i];
+    }
+}
+
+void andnot_scalar(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] &= ~b[i];
+    }
+}
+
+std::size_t count_scalar(const std::uint64_t *a, std::size_t n) {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        count += __builtin_popcountll(a[i]);
+    }
+    return count;
+}
+
+#ifdef TUBE_SET_HAS_SIMD
+__attribute__((target("avx2")))
+void or_avx2(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_or_si256(x, y));
+    }
+    or_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void and_avx2(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_and_si256(x, y));
+    }
+    and_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void andnot_avx2(std::uint64_t *a, const std::uint64_t *b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        // andnot clears the bits of its first operand
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_andnot_si256(y, x));
+    }
+    andnot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("popcnt")))
+std::size_t count_popcnt(const std::uint64_t *a, std::size_t n) {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        count += __builtin_popcountll(a[i]);
+    }
+    return count;
+}
+#endif
+
+struct kernels {
+    combine_func or_words = or_scalar;
+    combine_func and_words = and_scalar;
+    combine_func andnot_words = andnot_scalar;
+    count_func count_words = count_scalar;
+
+    kernels() {
+#ifdef TUBE_SET_HAS_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            or_words = or_avx2;
+            and_words = and_avx2;
+            andnot_words = andnot_avx2;
+        }
+        if (__builtin_cpu_supports("popcnt")) {
+            count_words = count_popcnt;
+        }
+#endif
+    }
+};
+
+// Picked once, based on what the CPU supports
+const kernels& simd() {
+    static const kernels picked;
+    return picked;
+}
+
+void check_same_table(std::size_t a, std::size_t b) {
+    if (a != b) {
+        throw std::invalid_argument("tube sets of different tube tables");
+    }
+}
+
+}
+
+tube_set::tube_set(std::size_t tube_count, bool all) :
+        tubes(tube_count), words((tube_count + 63) / 64, all ? ~std::uint64_t(0) : 0) {
+    if (all && tube_count % 64 != 0) {
+        words.back() = (std::uint64_t(1) << tube_count % 64) - 1;
+    }
+}
+
+tube_set& tube_set::operator|=(const tube_set &other) {
+    check_same_table(tubes, other.tubes);
+    simd().or_words(words.data(), other.words.data(), words.size());
+    return *this;
+}
+
+tube_set& tube_set::operator&=(const tube_set &other) {
+    check_same_table(tubes, other.tubes);
+    simd().and_words(words.data(), other.words.data(), words.size());
+    return *this;
+}
+
+tube_set& tube_set::operator-=(const tube_set &other) {
+    check_same_table(tubes, other.tubes);
+    simd().andnot_words(words.data(), other.words.data(), words.size());
+    return *this;
+}
+
+tube_set tube_set::operator~() const {
+    tube_set all(tubes, true);
+    return all -= *this;
+}
+
+std::size_t tube_set::count() const {
+    return simd().count_words(words.data(), words.size());
+}
+
+std::vector<std::uint32_t> tube_set::indices() const {
+    std::vector<std::uint32_t> found;
+    found.reserve(count());
+    for (std::size_t w = 0; w < words.size(); ++w) {
+        for (std::uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+            found.push_back(w * 64 + __builtin_ctzll(bits));
+        }
+    }
+    return found;
+}
@@ -0,0 +1,59 @@
+#ifndef TUBE_SET_H
+#define TUBE_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A set of tubes as one bit per tube table index. Sets combined with each
+// other must be over the same table.
+class tube_set {
+public:
+    tube_set() = default;
+    // Empty, or all tubes of the table
+    explicit tube_set(std::size_t tube_count, bool all = false);
+
+    std::size_t tube_count() const {
+        return tubes;
+    }
+
+    void insert(std::size_t i) {
+        words[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    bool contains(std::size_t i) const {
+        return words[i / 64] >> (i % 64) & 1;
+    }
+
+    tube_set& operator|=(const tube_set &other);
+    tube_set& operator&=(const tube_set &other);
+    // Removes the tubes of other
+    tube_set& operator-=(const tube_set &other);
+    // The tubes of the table that are not in the set
+    tube_set operator~() const;
+
+    // Number of tubes in the set
+    std::size_t count() const;
+
+    // The tube indices in increasing order
+    std::vector<std::uint32_t> indices() const;
+
+private:
+    std::size_t tubes = 0;
+    // Bits past tube_count are always clear
+    std::vector<std::uint64_t> words;
+};
+
+inline tube_set operator|(tube_set a, const tube_set &b) {
+    return a |= b;
+}
+
+inline tube_set operator&(tube_set a, const tube_set &b) {
+    return a &= b;
+}
+
+inline tube_set operator-(tube_set a, const tube_set &b) {
+    return a -= b;
+}
+
+#endif
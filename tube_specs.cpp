@@ -0,0 +1,115 @@
+#include "tube_specs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "inc/csv.h"
+
+namespace {
+
+struct length_field {
+    const char *name;
+    float tube_specs::*member;
+    bool required;
+};
+
+struct count_field {
+    const char *name;
+    unsigned tube_specs::*member;
+};
+
+const length_field length_fields[] = {
+        { "TUBE_OD", &tube_specs::tube_od, true },
+        { "X_PITCH", &tube_specs::x_pitch, false },
+        { "Y_PITCH", &tube_specs::y_pitch, false },
+        { "CALLE_ANCHA", &tube_specs::calle_ancha, true },
+        { "CALLE_ANGOSTA", &tube_specs::calle_angosta, false },
+        { "ANCHO_X_MAX", &tube_specs::ancho_x_max, false },
+        { "ANCHO_X_MIN", &tube_specs::ancho_x_min, false },
+        { "ALTO_Y_MAX", &tube_specs::alto_y_max, false },
+        { "ALTO_Y_MIN", &tube_specs::alto_y_min, false },
+};
+
+const count_field count_fields[] = {
+        { "MAX_NUMBER_ROWS", &tube_specs::max_number_rows },
+        { "MAX_NUMBER_COLS", &tube_specs::max_number_cols },
+};
+
+std::runtime_error spec_error(const char *file_name, unsigned line,
+        const std::string &message) {
+    return std::runtime_error(std::string(file_name) + ":"
+            + std::to_string(line) + ": " + message);
+}
+
+void check_unit(const char *file_name, unsigned line, const std::string &key,
+        const char *unit, const char *expected) {
+    if (std::strcmp(unit, expected) != 0) {
+        throw spec_error(file_name, line, key + " must be given in \""
+                + expected + "\", not \"" + unit + "\"");
+    }
+}
+
+}
+
+tube_specs read_tube_specs(const char *file_name) {
+    io::CSVReader<3, io::trim_chars<' ', '\t'>, io::no_quote_escape<';'>> in(
+            file_name);
+    in.read_header(io::ignore_extra_column, "Dato", "Valor", "Unidad");
+
+    tube_specs specs;
+    bool found[std::size(length_fields)] = { };
+    char *dato = nullptr, *valor = nullptr, *unidad = nullptr;
+    while (in.read_row(dato, valor, unidad)) {
+        unsigned line = in.get_file_line();
+        std::string key = dato;
+        std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+
+        if (key == "CONFIGURATION") {
+            specs.configuration = valor;
+            continue;
+        }
+
+        auto length = std::find_if(std::begin(length_fields),
+                std::end(length_fields), [&](const length_field &field) {
+                    return key == field.name;
+                });
+        if (length != std::end(length_fields)) {
+            check_unit(file_name, line, key, unidad, "in");
+            char *end;
+            specs.*length->member = std::strtof(valor, &end);
+            if (end == valor || *end != '\0') {
+                throw spec_error(file_name, line, "Invalid length \""
+                        + std::string(valor) + "\" for " + key);
+            }
+            found[length - std::begin(length_fields)] = true;
+            continue;
+        }
+
+        auto count = std::find_if(std::begin(count_fields),
+                std::end(count_fields), [&](const count_field &field) {
+                    return key == field.name;
+                });
+        if (count != std::end(count_fields)) {
+            check_unit(file_name, line, key, unidad, "units");
+            // Unlike strtoul, from_chars rejects signs and out of range values
+            const char *end = valor + std::strlen(valor);
+            auto result = std::from_chars(valor, end, specs.*count->member);
+            if (result.ec != std::errc() || result.ptr != end) {
+                throw spec_error(file_name, line, "Invalid count \""
+                        + std::string(valor) + "\" for " + key);
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < std::size(length_fields); ++i) {
+        if (length_fields[i].required && !found[i]) {
+            throw std::runtime_error(std::string(file_name) + ": missing "
+                    + length_fields[i].name);
+        }
+    }
+    return specs;
+}
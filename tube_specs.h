@@ -0,0 +1,27 @@
+#ifndef TUBE_SPECS_H
+#define TUBE_SPECS_H
+
+#include <string>
+
+// Contents of tube_specs.csv. Lengths are in inches.
+struct tube_specs {
+    float tube_od = 0;
+    float x_pitch = 0;
+    float y_pitch = 0;
+    std::string configuration;
+    float calle_ancha = 0;
+    float calle_angosta = 0;
+    unsigned max_number_rows = 0;
+    unsigned max_number_cols = 0;
+    float ancho_x_max = 0;
+    float ancho_x_min = 0;
+    float alto_y_max = 0;
+    float alto_y_min = 0;
+};
+
+// Reads the whole spec file in a single pass. Keys are case insensitive and
+// units are checked; a missing TUBE_OD or CALLE_ANCHA, an unparsable value
+// or an unexpected unit throws std::runtime_error.
+tube_specs read_tube_specs(const char *file_name);
+
+#endif
@@ -0,0 +1,120 @@
+#include "tube_table.h"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+std::uint64_t key_of(tube_leg side, std::uint32_t tube_number) {
+    return std::uint64_t(tube_number) << 1 | (side == tube_leg::cl);
+}
+
+std::vector<axis_label> to_labels(const std::map<std::uint16_t, float> &positions) {
+    std::vector<axis_label> labels;
+    labels.reserve(positions.size());
+    for (auto [label, position] : positions) {
+        labels.push_back( { label, position });
+    }
+    return labels;
+}
+
+}
+
+void tube_table::reserve(std::size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    col.reserve(count);
+    row.reserve(count);
+    leg.reserve(count);
+    number.reserve(count);
+    reserve_index(count);
+}
+
+std::size_t tube_table::add(tube_leg side, std::uint32_t tube_number,
+        std::uint16_t tube_col, std::uint16_t tube_row, float tube_x,
+        float tube_y) {
+    reserve_index(size() + 1);
+    std::size_t slot = slot_of(side, tube_number);
+    if (index.item(slot) != open_index::npos) {
+        return index.item(slot);
+    }
+
+    index.set(slot, size());
+    x.push_back(tube_x);
+    y.push_back(tube_y);
+    col.push_back(tube_col);
+    row.push_back(tube_row);
+    leg.push_back(side);
+    number.push_back(tube_number);
+    return size() - 1;
+}
+
+std::size_t tube_table::find(tube_leg side,
+        std::uint32_t tube_number) const {
+    if (index.empty()) {
+        return npos;
+    }
+    return index.item(slot_of(side, tube_number));
+}
+
+std::size_t tube_table::find(const std::string &id) const {
+    tube_leg side;
+    if (id.compare(0, 2, "hl") == 0) {
+        side = tube_leg::hl;
+    } else if (id.compare(0, 2, "cl") == 0) {
+        side = tube_leg::cl;
+    } else {
+        return npos;
+    }
+
+    std::uint32_t tube_number;
+    if (!parse_number(std::string_view(id).substr(2), tube_number)) {
+        return npos;
+    }
+    return find(side, tube_number);
+}
+
+std::string tube_table::id(std::size_t i) const {
+    return leg_name(leg[i]) + std::to_string(number[i]);
+}
+
+std::size_t tube_table::slot_of(tube_leg side,
+        std::uint32_t tube_number) const {
+    return index.slot_of(key_of(side, tube_number), [&](std::size_t i) {
+        return number[i] == tube_number && leg[i] == side;
+    });
+}
+
+void tube_table::reserve_index(std::size_t count) {
+    index.reserve(count, size(), [&](std::size_t i) {
+        return key_of(leg[i], number[i]);
+    });
+}
+
+const char* leg_name(tube_leg leg) {
+    return leg == tube_leg::hl ? "hl" : "cl";
+}
+
+tubesheet make_tubesheet(const tubesheet_columns &rows, float calle_ancha) {
+    tubesheet sheet;
+    sheet.tubes.reserve(2 * rows.size());
+
+    std::map<std::uint16_t, float> x_labels;
+    std::map<std::uint16_t, float> y_labels;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        sheet.tubes.add(tube_leg::hl, rows.tube_number[i], rows.x_label[i],
+                rows.y_label[i], rows.hl_x[i], rows.hl_y[i] + (calle_ancha / 2));
+
+        x_labels[rows.x_label[i]] = rows.hl_x[i];
+        y_labels[rows.y_label[i]] = rows.hl_y[i];
+    }
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        sheet.tubes.add(tube_leg::cl, rows.tube_number[i], rows.x_label[i],
+                rows.y_label[i], rows.cl_x[i] + 1.25f,
+                -(rows.cl_y[i] + (calle_ancha / 2)));
+    }
+
+    sheet.x_labels = to_labels(x_labels);
+    sheet.y_labels = to_labels(y_labels);
+    return sheet;
+}
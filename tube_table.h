@@ -0,0 +1,76 @@
+#ifndef TUBE_TABLE_H
+#define TUBE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "open_index.h"
+#include "tubesheet_csv.h"
+
+enum class tube_leg : std::uint8_t {
+    hl, cl
+};
+
+// All tubes of a tubesheet, one column per attribute. Tubes are identified
+// by leg and number ("hl12", "cl12") and looked up through an open
+// addressing index over the columns themselves.
+class tube_table {
+public:
+    static const std::size_t npos = std::size_t(-1);
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<std::uint16_t> col;
+    std::vector<std::uint16_t> row;
+    std::vector<tube_leg> leg;
+    std::vector<std::uint32_t> number;
+
+    std::size_t size() const {
+        return x.size();
+    }
+
+    void reserve(std::size_t count);
+
+    // Appends a tube and returns its index. A tube whose id is already in
+    // the table is not added again, the index of the existing one is
+    // returned instead.
+    std::size_t add(tube_leg side, std::uint32_t tube_number,
+            std::uint16_t tube_col, std::uint16_t tube_row, float tube_x,
+            float tube_y);
+
+    // Index of the tube or npos
+    std::size_t find(tube_leg side, std::uint32_t tube_number) const;
+    std::size_t find(const std::string &id) const;
+
+    // "hl12" style id of the tube at index i
+    std::string id(std::size_t i) const;
+
+private:
+    open_index index;
+
+    std::size_t slot_of(tube_leg side, std::uint32_t tube_number) const;
+    void reserve_index(std::size_t count);
+};
+
+const char* leg_name(tube_leg leg);
+
+struct axis_label {
+    std::uint16_t label;
+    float position;
+};
+
+// Tube table plus the positions of the row and column labels
+struct tubesheet {
+    tube_table tubes;
+    std::vector<axis_label> x_labels;
+    std::vector<axis_label> y_labels;
+};
+
+// Places both legs of every row: the hot leg tubes above the wide lane
+// (calle ancha) and the cold leg tubes mirrored below it. Hot leg tubes
+// come first, each leg in file order.
+tubesheet make_tubesheet(const tubesheet_columns &rows,
+        float calle_ancha);
+
+#endif
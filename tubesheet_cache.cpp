@@ -0,0 +1,468 @@
+#include "tubesheet_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "inc/csv.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char cache_magic[8] = { 'T', 'S', 'B', 'C', 'A', 'C', 'H', 'E' };
+const std::uint32_t cache_version = 1;
+// Written in native byte order, a cache from a machine of the other
+// endianness does not match
+const std::uint32_t cache_byte_order = 0x01020304;
+
+struct cache_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t file_size;
+    std::uint64_t row_count;
+    std::uint64_t strings_offset;
+    std::uint64_t strings_size;
+};
+
+// A file the cache was built from, the path is in the string table
+struct cache_source {
+    std::uint32_t path_offset;
+    std::uint32_t path_size;
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::uint64_t hash;
+};
+
+enum {
+    tubesheet_source, specs_source, source_count
+};
+
+struct cache_specs {
+    float tube_od;
+    float x_pitch;
+    float y_pitch;
+    float calle_ancha;
+    float calle_angosta;
+    float ancho_x_max;
+    float ancho_x_min;
+    float alto_y_max;
+    float alto_y_min;
+    std::uint32_t max_number_rows;
+    std::uint32_t max_number_cols;
+    std::uint32_t configuration_offset;
+    std::uint32_t configuration_size;
+};
+
+// Everything is stored as the raw bytes of these
+static_assert(std::is_trivially_copyable<cache_header>::value, "");
+static_assert(std::is_trivially_copyable<cache_source>::value, "");
+static_assert(std::is_trivially_copyable<cache_specs>::value, "");
+
+// The whole content of a file, mapped if possible
+class file_bytes {
+public:
+    explicit file_bytes(const std::string &file_name) {
+#ifdef CSV_IO_HAS_MMAP
+        mapping = io::MappedFile::open(file_name.c_str());
+        if (mapping) {
+            first = mapping->begin();
+            last = mapping->end();
+            return;
+        }
+#endif
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Can not open " + file_name);
+        }
+        copy.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+        first = copy.data();
+        last = first + copy.size();
+    }
+
+    const char* begin() const {
+        return first;
+    }
+
+    const char* end() const {
+        return last;
+    }
+
+    std::size_t size() const {
+        return last - first;
+    }
+
+private:
+#ifdef CSV_IO_HAS_MMAP
+    std::unique_ptr<io::MappedFile> mapping;
+#endif
+    std::vector<char> copy;
+    const char *first = nullptr;
+    const char *last = nullptr;
+};
+
+std::uint64_t fnv1a(const char *begin, const char *end) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (; begin != end; ++begin) {
+        hash ^= static_cast<unsigned char>(*begin);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string absolute_path(const char *file_name) {
+    return fs::absolute(file_name).lexically_normal().string();
+}
+
+// Size and modification time of a source file, nothing if it is missing
+bool stat_source(const std::string &path, cache_source &source) {
+    std::error_code ec;
+    std::uintmax_t size = fs::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    source.size = size;
+    source.mtime = mtime.time_since_epoch().count();
+    return true;
+}
+
+// Builds the cache contents with appends in file order
+class cache_builder {
+public:
+    template<class T>
+    void append(const T &value) {
+        append_bytes(&value, sizeof(value));
+    }
+
+    template<class T>
+    void append_column(const std::vector<T> &column) {
+        append_bytes(column.data(), column.size() * sizeof(T));
+    }
+
+    std::uint32_t add_string(const std::string &s) {
+        std::uint32_t offset = strings.size();
+        strings += s;
+        return offset;
+    }
+
+    // Appends the string table and fills in the header
+    std::string finish(std::size_t row_count) {
+        bytes.resize((bytes.size() + 7) / 8 * 8);
+        cache_header header;
+        std::memcpy(header.magic, cache_magic, sizeof(header.magic));
+        header.version = cache_version;
+        header.byte_order = cache_byte_order;
+        header.row_count = row_count;
+        header.strings_offset = bytes.size();
+        header.strings_size = strings.size();
+        header.file_size = bytes.size() + strings.size();
+        std::memcpy(&bytes[0], &header, sizeof(header));
+        bytes += strings;
+        return std::move(bytes);
+    }
+
+private:
+    std::string bytes = std::string(sizeof(cache_header), '\0');
+    std::string strings;
+
+    void append_bytes(const void *data, std::size_t size) {
+        bytes.append(static_cast<const char*>(data), size);
+    }
+};
+
+// Reads the cache contents in file order, every read is bounds checked
+class cache_parser {
+public:
+    cache_parser(const char *begin, const char *end) :
+            pos(begin), end(end) {
+    }
+
+    template<class T>
+    bool read(T &value) {
+        return read_bytes(&value, sizeof(value));
+    }
+
+    template<class T>
+    bool read_column(std::vector<T> &column, std::size_t count) {
+        if (count > std::size_t(end - pos) / sizeof(T)) {
+            return false;
+        }
+        column.resize(count);
+        return read_bytes(column.data(), count * sizeof(T));
+    }
+
+private:
+    const char *pos;
+    const char *end;
+
+    bool read_bytes(void *data, std::size_t size) {
+        if (size > std::size_t(end - pos)) {
+            return false;
+        }
+        std::memcpy(data, pos, size);
+        pos += size;
+        return true;
+    }
+};
+
+bool string_at(const char *strings, std::size_t strings_size,
+        std::uint32_t offset, std::uint32_t size, std::string &s) {
+    if (offset > strings_size || size > strings_size - offset) {
+        return false;
+    }
+    s.assign(strings + offset, size);
+    return true;
+}
+
+enum class source_state {
+    changed, unchanged, touched
+};
+
+// Compares a source file with the stamp in the cache. A file with a new
+// modification time but the same size is hashed before it counts as changed.
+source_state check_source(const std::string &path, const cache_source &cached) {
+    cache_source current;
+    if (!stat_source(path, current) || current.size != cached.size) {
+        return source_state::changed;
+    }
+    if (current.mtime == cached.mtime) {
+        return source_state::unchanged;
+    }
+    file_bytes content(path);
+    if (fnv1a(content.begin(), content.end()) != cached.hash) {
+        return source_state::changed;
+    }
+    return source_state::touched;
+}
+
+bool load_cache(const std::string &cache_name, const char *tubesheet_name,
+        const char *specs_name, tubesheet_sources &sources, bool &touched) {
+    std::error_code ec;
+    if (!fs::is_regular_file(cache_name, ec)) {
+        return false;
+    }
+    file_bytes cache(cache_name);
+    cache_parser in(cache.begin(), cache.end());
+
+    cache_header header;
+    if (!in.read(header)
+            || std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+            || header.version != cache_version
+            || header.byte_order != cache_byte_order
+            || header.file_size != cache.size()
+            || header.strings_offset > cache.size()
+            || header.strings_size != cache.size() - header.strings_offset) {
+        return false;
+    }
+    const char *strings = cache.begin() + header.strings_offset;
+
+    const std::string paths[source_count] = { absolute_path(tubesheet_name),
+            absolute_path(specs_name) };
+    touched = false;
+    for (int i = 0; i < source_count; ++i) {
+        cache_source source;
+        std::string path;
+        if (!in.read(source)
+                || !string_at(strings, header.strings_size, source.path_offset,
+                        source.path_size, path) || path != paths[i]) {
+            return false;
+        }
+        source_state state = check_source(paths[i], source);
+        if (state == source_state::changed) {
+            return false;
+        }
+        touched |= state == source_state::touched;
+    }
+
+    cache_specs specs;
+    if (!in.read(specs)
+            || !string_at(strings, header.strings_size,
+                    specs.configuration_offset, specs.configuration_size,
+                    sources.specs.configuration)) {
+        return false;
+    }
+    sources.specs.tube_od = specs.tube_od;
+    sources.specs.x_pitch = specs.x_pitch;
+    sources.specs.y_pitch = specs.y_pitch;
+    sources.specs.calle_ancha = specs.calle_ancha;
+    sources.specs.calle_angosta = specs.calle_angosta;
+    sources.specs.max_number_rows = specs.max_number_rows;
+    sources.specs.max_number_cols = specs.max_number_cols;
+    sources.specs.ancho_x_max = specs.ancho_x_max;
+    sources.specs.ancho_x_min = specs.ancho_x_min;
+    sources.specs.alto_y_max = specs.alto_y_max;
+    sources.specs.alto_y_min = specs.alto_y_min;
+
+    tubesheet_columns &rows = sources.rows;
+    std::size_t count = header.row_count;
+    return in.read_column(rows.tube_number, count)
+            && in.read_column(rows.cl_x, count)
+            && in.read_column(rows.cl_y, count)
+            && in.read_column(rows.hl_x, count)
+            && in.read_column(rows.hl_y, count)
+            && in.read_column(rows.x_label, count)
+            && in.read_column(rows.y_label, count);
+}
+
+// Stamps are taken before a source is parsed; if it changes while it is
+// read the cache looks stale on the next run instead of current.
+bool stamp_source(const char *file_name, cache_source &source) {
+    std::string path = absolute_path(file_name);
+    if (!stat_source(path, source)) {
+        return false;
+    }
+    file_bytes content(path);
+    source.hash = fnv1a(content.begin(), content.end());
+    return true;
+}
+
+void save_cache(const std::string &cache_name, const char *tubesheet_name,
+        const char *specs_name, const cache_source (&stamps)[source_count],
+        const tubesheet_sources &sources) {
+    cache_builder out;
+
+    const char *names[source_count] = { tubesheet_name, specs_name };
+    for (int i = 0; i < source_count; ++i) {
+        cache_source source = stamps[i];
+        std::string path = absolute_path(names[i]);
+        source.path_offset = out.add_string(path);
+        source.path_size = path.size();
+        out.append(source);
+    }
+
+    const tube_specs &specs = sources.specs;
+    cache_specs cached;
+    cached.tube_od = specs.tube_od;
+    cached.x_pitch = specs.x_pitch;
+    cached.y_pitch = specs.y_pitch;
+    cached.calle_ancha = specs.calle_ancha;
+    cached.calle_angosta = specs.calle_angosta;
+    cached.max_number_rows = specs.max_number_rows;
+    cached.max_number_cols = specs.max_number_cols;
+    cached.ancho_x_max = specs.ancho_x_max;
+    cached.ancho_x_min = specs.ancho_x_min;
+    cached.alto_y_max = specs.alto_y_max;
+    cached.alto_y_min = specs.alto_y_min;
+    cached.configuration_offset = out.add_string(specs.configuration);
+    cached.configuration_size = specs.configuration.size();
+    out.append(cached);
+
+    const tubesheet_columns &rows = sources.rows;
+    out.append_column(rows.tube_number);
+    out.append_column(rows.cl_x);
+    out.append_column(rows.cl_y);
+    out.append_column(rows.hl_x);
+    out.append_column(rows.hl_y);
+    out.append_column(rows.x_label);
+    out.append_column(rows.y_label);
+    std::string bytes = out.finish(rows.size());
+
+    std::string temp_name = cache_name + ".tmp";
+    {
+        std::ofstream file(temp_name, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+        if (!file) {
+            std::remove(temp_name.c_str());
+            throw std::runtime_error("Can not write " + temp_name);
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp_name, cache_name, ec);
+    if (ec) {
+        std::remove(temp_name.c_str());
+        throw std::runtime_error("Can not replace " + cache_name + ": "
+                + ec.message());
+    }
+}
+
+bool stamp_sources(const char *tubesheet_name, const char *specs_name,
+        cache_source (&stamps)[source_count]) {
+    return stamp_source(tubesheet_name, stamps[tubesheet_source])
+            && stamp_source(specs_name, stamps[specs_source]);
+}
+
+}
+
+std::string tubesheet_cache_name(const char *tubesheet_name) {
+    return fs::path(tubesheet_name).replace_extension(".tsb").string();
+}
+
+bool load_tubesheet_cache(const std::string &cache_name,
+        const char *tubesheet_name, const char *specs_name,
+        tubesheet_sources &sources) {
+    bool touched;
+    return load_cache(cache_name, tubesheet_name, specs_name, sources, touched);
+}
+
+void save_tubesheet_cache(const std::string &cache_name,
+        const char *tubesheet_name, const char *specs_name,
+        const tubesheet_sources &sources) {
+    cache_source stamps[source_count];
+    if (!stamp_sources(tubesheet_name, specs_name, stamps)) {
+        throw std::runtime_error("Can not stat the sources of " + cache_name);
+    }
+    save_cache(cache_name, tubesheet_name, specs_name, stamps, sources);
+}
+
+tubesheet_sources read_tubesheet_sources(const char *tubesheet_name,
+        const char *specs_name, unsigned threads, bool use_cache) {
+    tubesheet_sources sources;
+    if (!use_cache) {
+        sources.specs = read_tube_specs(specs_name);
+        sources.rows = read_tubesheet(tubesheet_name, threads);
+        return sources;
+    }
+
+    std::string cache_name = tubesheet_cache_name(tubesheet_name);
+    bool touched = false;
+    bool loaded = false;
+    try {
+        loaded = load_cache(cache_name, tubesheet_name, specs_name, sources,
+                touched);
+    } catch (const std::exception&) {
+        // An unreadable cache or source is handled like a stale cache, the
+        // CSV reader reports the source problems
+    }
+    if (loaded) {
+        if (touched) {
+            // Same contents under a new modification time, store the new
+            // stamps so the next run does not hash again
+            try {
+                save_tubesheet_cache(cache_name, tubesheet_name, specs_name,
+                        sources);
+            } catch (const std::exception &err) {
+                std::cerr << "Could not update " << cache_name << ": "
+                        << err.what() << '\n';
+            }
+        }
+        return sources;
+    }
+
+    cache_source stamps[source_count];
+    bool stamped = stamp_sources(tubesheet_name, specs_name, stamps);
+    sources = tubesheet_sources();
+    sources.specs = read_tube_specs(specs_name);
+    sources.rows = read_tubesheet(tubesheet_name, threads);
+    if (stamped) {
+        try {
+            save_cache(cache_name, tubesheet_name, specs_name, stamps, sources);
+        } catch (const std::exception &err) {
+            std::cerr << "Could not write " << cache_name << ": " << err.what()
+                    << '\n';
+        }
+    }
+    return sources;
+}
@@ -0,0 +1,41 @@
+#ifndef TUBESHEET_CACHE_H
+#define TUBESHEET_CACHE_H
+
+#include <string>
+#include "tube_specs.h"
+#include "tubesheet_csv.h"
+
+// Contents of tube_specs.csv and tubesheet.csv as read from the CSV files
+struct tubesheet_sources {
+    tube_specs specs;
+    tubesheet_columns rows;
+};
+
+// The binary cache (.tsb) kept next to a tubesheet CSV starts with the path,
+// size, modification time and FNV-1a hash of both CSV files, followed by the
+// tube spec, the tubesheet columns and a string table. A cache is used while
+// size and modification time of both files are unchanged; if only the time
+// differs the content hash decides.
+
+// "dir/tubesheet.csv" -> "dir/tubesheet.tsb"
+std::string tubesheet_cache_name(const char *tubesheet_name);
+
+// Returns false if the cache is missing, damaged or was built from other
+// files or other contents of them.
+bool load_tubesheet_cache(const std::string &cache_name,
+        const char *tubesheet_name, const char *specs_name,
+        tubesheet_sources &sources);
+
+// Writes the cache through a temporary file, so readers never see a partial
+// one. Throws std::runtime_error if it can not be written.
+void save_tubesheet_cache(const std::string &cache_name,
+        const char *tubesheet_name, const char *specs_name,
+        const tubesheet_sources &sources);
+
+// Loads both files from the cache if it is current, otherwise parses the CSV
+// files and rebuilds the cache. Failing to write the cache is reported on
+// std::cerr but is not an error.
+tubesheet_sources read_tubesheet_sources(const char *tubesheet_name,
+        const char *specs_name, unsigned threads = 1, bool use_cache = true);
+
+#endif
@@ -0,0 +1,194 @@
+#include "tubesheet_csv.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include "inc/csv.h"
+#include "parallel.h"
+
+namespace {
+
+typedef io::CSVReader<7, io::trim_chars<' ', '\t'>, io::no_quote_escape<';'>> tubesheet_reader;
+
+// Ranges smaller than this are not worth a thread of their own
+const std::size_t min_chunk_size = 1 << 16;
+
+struct invalid_tube_id :
+        io::error::base,
+        io::error::with_file_name,
+        io::error::with_file_line,
+        io::error::with_column_content {
+    void format_error_message() const override {
+        std::snprintf(error_message_buffer, sizeof(error_message_buffer),
+                R"(The tube id "%s" in file "%s" in line "%d" is not of the form "TUBE.n".)",
+                column_content, file_name, file_line);
+    }
+};
+
+void read_header(tubesheet_reader &in) {
+    in.read_header(io::ignore_extra_column, "x_label", "y_label", "cl_x",
+            "cl_y", "hl_x", "hl_y", "tube_id");
+}
+
+template<class T>
+void append_column(std::vector<T> &to, std::vector<T> &from) {
+    to.insert(to.end(), from.begin(), from.end());
+    std::vector<T>().swap(from);
+}
+
+// Columns are parsed this many rows at a time, the tube ids of a batch are
+// kept as views into the reader's row arena until they are converted
+const std::size_t batch_size = 4096;
+
+void read_rows(tubesheet_reader &in, tubesheet_columns &columns) {
+    std::vector<std::string_view> tube_ids;
+    tube_ids.reserve(batch_size);
+    in.enable_row_arena();
+    std::size_t count;
+    do {
+        count = in.read_rows(batch_size, columns.x_label, columns.y_label,
+                columns.cl_x, columns.cl_y, columns.hl_x, columns.hl_y, tube_ids);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t number;
+            if (!parse_tube_number(tube_ids[i], number)) {
+                throw_invalid_tube_id(in.get_truncated_file_name(),
+                        in.get_file_line() - (count - 1 - i), tube_ids[i]);
+            }
+            columns.tube_number.push_back(number);
+        }
+        tube_ids.clear();
+        in.release_rows();
+    } while (count == batch_size);
+}
+
+#ifdef CSV_IO_HAS_MMAP
+tubesheet_columns read_tubesheet_parallel(const char *file_name,
+        io::MappedFile &file, unsigned threads) {
+    char *begin = file.begin();
+    char *end = file.end();
+
+    // The header is parsed on its own, every chunk then adopts its layout
+    char *body = std::find(begin, end, '\n');
+    if (body != end) {
+        ++body;
+    }
+    tubesheet_reader header(file_name, begin, body, io::in_place);
+    read_header(header);
+
+    std::size_t chunk_count = std::max<std::size_t>(1,
+            std::min<std::size_t>(threads, (end - body) / min_chunk_size));
+    std::vector<char*> bounds(chunk_count + 1, end);
+    bounds[0] = body;
+    for (std::size_t i = 1; i < chunk_count; ++i) {
+        char *bound = std::max(bounds[i - 1], body + (end - body) / chunk_count * i);
+        bound = std::find(bound, end, '\n');
+        bounds[i] = bound == end ? end : bound + 1;
+    }
+
+    std::vector<tubesheet_columns> chunks(chunk_count);
+    std::vector<unsigned> line_counts(chunk_count);
+    std::vector<char> done(chunk_count, false);
+    try {
+        parallel_for(chunk_count, threads, [&](std::size_t i) {
+            tubesheet_reader in(file_name, bounds[i], bounds[i + 1], io::in_place);
+            in.copy_header(header);
+            read_rows(in, chunks[i]);
+            line_counts[i] = in.get_file_line();
+            done[i] = true;
+        });
+    } catch (io::error::with_file_line &err) {
+        // The error is the one of the first failing chunk and every chunk
+        // before it was read completely, which turns the line number within
+        // the chunk into one within the file.
+        unsigned line = 1;
+        for (std::size_t i = 0; i < chunk_count && done[i]; ++i) {
+            line += line_counts[i];
+        }
+        err.set_file_line(err.file_line + line);
+        throw;
+    }
+
+    std::size_t row_count = 0;
+    for (const auto &chunk : chunks) {
+        row_count += chunk.size();
+    }
+    tubesheet_columns columns;
+    columns.reserve(row_count);
+    for (auto &chunk : chunks) {
+        columns.append(std::move(chunk));
+    }
+    return columns;
+}
+#endif
+
+}
+
+bool parse_number(std::string_view digits, std::uint32_t &number) {
+    if (digits.empty()) {
+        return false;
+    }
+    std::uint64_t value = 0;
+    for (char c : digits) {
+        if (c < '0' || '9' < c) {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+        if (value > UINT32_MAX) {
+            return false;
+        }
+    }
+    number = std::uint32_t(value);
+    return true;
+}
+
+bool parse_tube_number(std::string_view tube_id, std::uint32_t &number) {
+    return tube_id.compare(0, 5, "TUBE.") == 0
+            && parse_number(tube_id.substr(5), number);
+}
+
+void throw_invalid_tube_id(const char *file_name, unsigned line,
+        std::string_view tube_id) {
+    invalid_tube_id err;
+    err.set_file_name(file_name);
+    err.set_file_line(line);
+    err.set_column_content(std::string(tube_id).c_str());
+    throw err;
+}
+
+void tubesheet_columns::reserve(std::size_t count) {
+    x_label.reserve(count);
+    y_label.reserve(count);
+    cl_x.reserve(count);
+    cl_y.reserve(count);
+    hl_x.reserve(count);
+    hl_y.reserve(count);
+    tube_number.reserve(count);
+}
+
+void tubesheet_columns::append(tubesheet_columns &&other) {
+    append_column(x_label, other.x_label);
+    append_column(y_label, other.y_label);
+    append_column(cl_x, other.cl_x);
+    append_column(cl_y, other.cl_y);
+    append_column(hl_x, other.hl_x);
+    append_column(hl_y, other.hl_y);
+    append_column(tube_number, other.tube_number);
+}
+
+tubesheet_columns read_tubesheet(const char *file_name, unsigned threads) {
+#ifdef CSV_IO_HAS_MMAP
+    if (threads > 1) {
+        auto file = io::MappedFile::open(file_name);
+        if (file) {
+            return read_tubesheet_parallel(file_name, *file, threads);
+        }
+    }
+#endif
+
+    tubesheet_reader in(file_name);
+    read_header(in);
+    tubesheet_columns columns;
+    read_rows(in, columns);
+    return columns;
+}
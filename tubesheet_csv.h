@@ -0,0 +1,45 @@
+#ifndef TUBESHEET_CSV_H
+#define TUBESHEET_CSV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// The columns of tubesheet.csv, one element per line
+struct tubesheet_columns {
+    std::vector<std::uint16_t> x_label;
+    std::vector<std::uint16_t> y_label;
+    std::vector<float> cl_x;
+    std::vector<float> cl_y;
+    std::vector<float> hl_x;
+    std::vector<float> hl_y;
+    // The n of the "TUBE.n" tube_id
+    std::vector<std::uint32_t> tube_number;
+
+    std::size_t size() const {
+        return tube_number.size();
+    }
+
+    void reserve(std::size_t count);
+    // Moves the rows of other behind the ones already stored
+    void append(tubesheet_columns &&other);
+};
+
+// "123" -> 123; false if digits is empty, holds anything but digits or
+// does not fit into 32 bits
+bool parse_number(std::string_view digits, std::uint32_t &number);
+
+// "TUBE.123" -> 123; false if tube_id is not of that form
+bool parse_tube_number(std::string_view tube_id, std::uint32_t &number);
+
+// Throws the io::error for a tube id that parse_tube_number rejected
+[[noreturn]] void throw_invalid_tube_id(const char *file_name, unsigned line,
+        std::string_view tube_id);
+
+// Reads every row of a tubesheet CSV in file order. With more than one
+// thread the file is split into newline aligned byte ranges that are parsed
+// concurrently; the result is the same as for the serial read.
+tubesheet_columns read_tubesheet(const char *file_name, unsigned threads = 1);
+
+#endif
@@ -0,0 +1,407 @@
+#include "tubesheet_svg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "inc/rapidxml-1.13/rapidxml.hpp"
+#include "parallel.h"
+#include "svg_elements.h"
+#include "svg_writer.h"
+
+tubesheet_extent extent_of(const tube_table &tubes) {
+    tubesheet_extent extent;
+    extent.min_y = *std::min_element(tubes.y.begin(), tubes.y.end());
+    extent.max_x = *std::max_element(tubes.x.begin(), tubes.x.end());
+    extent.max_y = *std::max_element(tubes.y.begin(), tubes.y.end());
+    return extent;
+}
+
+svg_view_box view_box_of(const tubesheet_extent &extent) {
+    svg_view_box box;
+    box.x = -margin_x;
+    box.y = -margin_y + std::floor(extent.min_y);
+    box.width = std::ceil(extent.max_x) + margin_x;
+    box.height = std::ceil(2 * extent.max_y) + margin_y;
+    return box;
+}
+
+namespace {
+
+std::size_t distinct_count(std::vector<float> values) {
+    std::sort(values.begin(), values.end());
+    return std::unique(values.begin(), values.end()) - values.begin();
+}
+
+}
+
+std::size_t estimate_dom_pool_size(const tubesheet &sheet) {
+    const std::size_t node = sizeof(rapidxml::xml_node<char>);
+    const std::size_t attribute = sizeof(rapidxml::xml_attribute<char>);
+    const tube_table &tubes = sheet.tubes;
+
+    // The root, style, lines and their values
+    std::size_t size = 4 * node + 16 * attribute + 2048;
+    // g, title, circle and text with 10 attributes. Of the strings only the
+    // id, the title and half of the tube numbers are not shared.
+    size += tubes.size()
+            * (4 * node + 10 * attribute + pool_size(sizeof("hl4294967295"))
+                    + pool_size(sizeof("Col=65535 Row=65535"))
+                    + pool_size(sizeof("4294967295")) / 2);
+    // Every distinct coordinate is stored once
+    size += (distinct_count(tubes.x) + distinct_count(tubes.y))
+            * pool_size(svg_number_size / 2);
+    // Labels with their texts, column labels also with a transform
+    size += sheet.x_labels.size()
+            * (node + 4 * attribute + pool_size(sizeof("65535"))
+                    + pool_size(2 * svg_number_size));
+    size += 2 * sheet.y_labels.size()
+            * (node + 3 * attribute + pool_size(sizeof("65535"))
+                    + pool_size(svg_number_size / 2));
+    return size + size / 16;
+}
+
+bool cl_mirrors_hl(const tube_table &tubes, float &offset_x) {
+    // Coordinates are sums of a few floats of up to about 100 inches
+    const float tolerance = 1e-4f;
+    std::size_t hl_count = 0;
+    bool have_offset = false;
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        if (tubes.leg[i] != tube_leg::hl) {
+            continue;
+        }
+        ++hl_count;
+        std::size_t j = tubes.find(tube_leg::cl, tubes.number[i]);
+        if (j == tube_table::npos || tubes.col[j] != tubes.col[i]
+                || tubes.row[j] != tubes.row[i]) {
+            return false;
+        }
+        if (!have_offset) {
+            offset_x = tubes.x[i] + tubes.x[j];
+            have_offset = true;
+        }
+        if (std::abs(tubes.x[j] - (offset_x - tubes.x[i])) > tolerance
+                || std::abs(tubes.y[j] + tubes.y[i]) > tolerance) {
+            return false;
+        }
+    }
+    return have_offset && 2 * hl_count == tubes.size();
+}
+
+namespace {
+
+// SVG 1.1 references other elements through xlink:href
+template<class Writer>
+void start_svg(Writer &out, const tubesheet_extent &extent,
+        bool xlink = false) {
+    out.start_element("svg");
+    out.attribute("height", "auto");
+    out.attribute("id", "tubesheet_svg");
+    out.attribute("version", "1.1");
+    out.attribute("viewBox", view_box_text(view_box_of(extent), out.numbers()));
+    out.attribute("width", "auto");
+    out.attribute("xmlns", "http://www.w3.org/2000/svg");
+    if (xlink) {
+        out.attribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
+    }
+}
+
+// Center lines and row and column labels
+template<class Writer>
+void add_axes(Writer &out, const tubesheet &sheet, float calle_ancha,
+        const tubesheet_extent &extent) {
+    add_center_lines(out, extent);
+    add_labels(out, sheet, calle_ancha);
+}
+
+template<class Writer>
+void add_tube_range(Writer &out, const tube_table &tubes, float radius,
+        const tube_overlay *overlay, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+        add_tube(out, tubes.x[i], tubes.y[i], radius, tubes.id(i),
+                tubes.col[i], tubes.row[i],
+                overlay ? overlay->class_of_tube(i) : "tube");
+    }
+}
+
+// rapidxml documents can not be built from several threads
+void add_tubes(svg_dom_writer &out, const tube_table &tubes, float radius,
+        const tube_overlay *overlay, unsigned) {
+    add_tube_range(out, tubes, radius, overlay, 0, tubes.size());
+}
+
+// Workers format chunks of tubes into fragments, which are appended in
+// table order. Chunks are taken in rounds of a few per thread, which bounds
+// the memory held by finished fragments.
+void add_tubes(svg_stream_writer &out, const tube_table &tubes, float radius,
+        const tube_overlay *overlay, unsigned threads) {
+    const std::size_t chunk_size = 2048;
+    if (threads <= 1 || tubes.size() <= chunk_size) {
+        add_tube_range(out, tubes, radius, overlay, 0, tubes.size());
+        return;
+    }
+
+    std::size_t chunk_count = (tubes.size() + chunk_size - 1) / chunk_size;
+    std::vector<std::string> fragments(std::min<std::size_t>(chunk_count,
+            4 * threads));
+    for (std::size_t first = 0; first < chunk_count;
+            first += fragments.size()) {
+        std::size_t round = std::min(fragments.size(), chunk_count - first);
+        parallel_for(round, threads, [&](std::size_t k) {
+            std::size_t begin = (first + k) * chunk_size;
+            svg_stream_writer fragment(out.depth(), out.numbers());
+            add_tube_range(fragment, tubes, radius, overlay, begin,
+                    std::min(begin + chunk_size, tubes.size()));
+            fragments[k] = fragment.take_fragment();
+        });
+        for (std::size_t k = 0; k < round; ++k) {
+            out.append_fragment(fragments[k]);
+        }
+    }
+}
+
+template<class Writer>
+void write_tube_groups(Writer &out, const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const svg_options &options) {
+    const tube_table &tubes = sheet.tubes;
+    float tube_r = specs.tube_od / 2;
+
+    start_svg(out, extent);
+
+    add_style(out, tubesheet_css, options.overlay);
+
+    add_axes(out, sheet, specs.calle_ancha, extent);
+
+    add_tubes(out, tubes, tube_r, options.overlay, options.threads);
+
+    out.end_element();
+}
+
+// The tubes of one leg as bare <use> elements, in a group with the given id.
+// Their ids and labels are left to the tube index, where the n-th <use> of
+// the group is the n-th tube of the leg.
+template<class Writer>
+void add_tube_uses(Writer &out, const tube_table &tubes, tube_leg side,
+        const char *group_id, const tube_overlay *overlay) {
+    out.start_element("g");
+    out.attribute("id", group_id);
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        if (tubes.leg[i] != side) {
+            continue;
+        }
+        out.start_element("use");
+        if (overlay) {
+            out.attribute("class", overlay->class_of_tube(i));
+        }
+        out.attribute("x", tubes.x[i]);
+        out.attribute("xlink:href", "#tube");
+        out.attribute("y", tubes.y[i]);
+        out.end_element();
+    }
+    out.end_element();
+}
+
+// The numbers of one leg's tubes, styled through the class of their group
+template<class Writer>
+void add_tube_numbers(Writer &out, const tube_table &tubes, tube_leg side) {
+    out.start_element("g");
+    out.attribute("class", "tube_num");
+    char number[svg_number_size];
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        if (tubes.leg[i] != side) {
+            continue;
+        }
+        out.start_element("text");
+        out.attribute("x", tubes.x[i]);
+        out.attribute("y", tubes.y[i]);
+        out.text(std::string_view(number, format_number(number, tubes.number[i])));
+        out.end_element();
+    }
+    out.end_element();
+}
+
+// For drawings whose tube numbers are styled through their group
+const char number_groups_css[] =
+        ".tube {stroke: black; stroke-width: 0.02; fill: white;} "
+                ".tube_num text { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: black;}"
+                ".label { text-anchor: middle; alignment-baseline: middle; font-family: sans-serif; font-size: 0.25px; fill: red;}";
+
+template<class Writer>
+void write_tube_uses(Writer &out, const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const svg_options &options) {
+    const tube_table &tubes = sheet.tubes;
+    const tube_overlay *overlay = options.overlay;
+    float offset_x = 0;
+    bool mirror_cl = options.mirror_cl && !overlay
+            && cl_mirrors_hl(tubes, offset_x);
+
+    start_svg(out, extent, true);
+
+    add_style(out, number_groups_css, overlay);
+
+    out.start_element("defs");
+    out.start_element("circle");
+    // With an overlay every <use> has the class, the circle inherits the
+    // fill of the one it is drawn for
+    if (!overlay) {
+        out.attribute("class", "tube");
+    }
+    out.attribute("id", "tube");
+    out.attribute("r", specs.tube_od / 2);
+    out.end_element();
+    out.end_element();
+
+    add_axes(out, sheet, specs.calle_ancha, extent);
+
+    add_tube_uses(out, tubes, tube_leg::hl, "hl_tubes", overlay);
+    if (mirror_cl) {
+        std::string transform = "matrix(-1,0,0,-1,";
+        append_number(transform, out.numbers(), offset_x);
+        transform += ",0)";
+        out.start_element("use");
+        out.attribute("transform", transform);
+        out.attribute("xlink:href", "#hl_tubes");
+        out.end_element();
+    } else {
+        add_tube_uses(out, tubes, tube_leg::cl, "cl_tubes", overlay);
+    }
+    // Numbers stay upright, so they are never mirrored
+    add_tube_numbers(out, tubes, tube_leg::hl);
+    add_tube_numbers(out, tubes, tube_leg::cl);
+
+    out.end_element();
+}
+
+template<class Writer>
+void write_tube_paths(Writer &out, const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const svg_options &options) {
+    const tube_table &tubes = sheet.tubes;
+    const tube_overlay *overlay = options.overlay;
+    float tube_r = specs.tube_od / 2;
+    number_cache numbers(out.numbers());
+
+    start_svg(out, extent);
+
+    add_style(out, number_groups_css, overlay);
+
+    add_axes(out, sheet, specs.calle_ancha, extent);
+
+    circle_path circles(numbers, tube_r);
+    circles.reserve(tubes.size());
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        circles.add(tubes.x[i], tubes.y[i]);
+    }
+    out.start_element("path");
+    out.attribute("class", "tube");
+    out.attribute("d", circles.d);
+    out.end_element();
+
+    if (overlay) {
+        // The tubes with a class once more on top, one path per class
+        std::vector<circle_path> overlay_circles(overlay->classes.size(),
+                circle_path(numbers, tube_r));
+        for (std::size_t i = 0; i < tubes.size(); ++i) {
+            if (overlay->class_of[i] != 0) {
+                overlay_circles[overlay->class_of[i]].add(tubes.x[i],
+                        tubes.y[i]);
+            }
+        }
+        for (std::size_t c = 1; c < overlay_circles.size(); ++c) {
+            out.start_element("path");
+            out.attribute("class", overlay->classes[c]);
+            out.attribute("d", overlay_circles[c].d);
+            out.end_element();
+        }
+    }
+
+    if (options.tube_numbers) {
+        add_tube_numbers(out, tubes, tube_leg::hl);
+        add_tube_numbers(out, tubes, tube_leg::cl);
+    }
+
+    out.end_element();
+}
+
+}
+
+template<class Writer>
+void write_tubesheet_svg(Writer &out, const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const svg_options &options) {
+    switch (options.mode) {
+    case svg_mode::groups:
+        write_tube_groups(out, sheet, specs, extent, options);
+        break;
+    case svg_mode::symbols:
+        write_tube_uses(out, sheet, specs, extent, options);
+        break;
+    case svg_mode::paths:
+        write_tube_paths(out, sheet, specs, extent, options);
+        break;
+    }
+    out.end_document();
+}
+
+template void write_tubesheet_svg(svg_stream_writer&, const tubesheet&,
+        const tube_specs&, const tubesheet_extent&, const svg_options&);
+template void write_tubesheet_svg(svg_dom_writer&, const tubesheet&,
+        const tube_specs&, const tubesheet_extent&, const svg_options&);
+
+tubesheet_base render_tubesheet_base(const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const number_format &numbers) {
+    const tube_table &tubes = sheet.tubes;
+    tubesheet_base base;
+    svg_stream_writer out(0, numbers);
+
+    // As write_tube_groups, noting the splice points on the way
+    start_svg(out, extent);
+    out.start_element("style");
+    out.attribute("type", "text/css");
+    out.text(tubesheet_css);
+    base.style_end = out.fragment_size();
+    out.end_element();
+
+    add_axes(out, sheet, specs.calle_ancha, extent);
+
+    std::vector<std::size_t> group_start(tubes.size());
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        group_start[i] = out.fragment_size();
+        add_tube_range(out, tubes, specs.tube_od / 2, nullptr, i, i + 1);
+    }
+    out.end_element();
+    out.end_document();
+    base.bytes = out.take_fragment();
+
+    const std::string_view circle_class = "<circle class=\"tube";
+    base.class_end.resize(tubes.size());
+    for (std::size_t i = 0; i < tubes.size(); ++i) {
+        base.class_end[i] = base.bytes.find(circle_class, group_start[i])
+                + circle_class.size();
+    }
+    return base;
+}
+
+void write_tubesheet_variant(std::ostream &out, const tubesheet_base &base,
+        const tube_overlay &overlay) {
+    std::size_t copied = 0;
+    auto copy_to = [&](std::size_t end) {
+        out.write(base.bytes.data() + copied, end - copied);
+        copied = end;
+    };
+
+    copy_to(base.style_end);
+    out << overlay.css;
+    for (std::size_t i = 0; i < base.class_end.size(); ++i) {
+        if (overlay.class_of[i] != 0) {
+            copy_to(base.class_end[i]);
+            // Past the "tube" the base already has
+            out << overlay.class_of_tube(i).substr(4);
+        }
+    }
+    copy_to(base.bytes.size());
+}
@@ -0,0 +1,113 @@
+#ifndef TUBESHEET_SVG_H
+#define TUBESHEET_SVG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "svg_writer.h"
+#include "tube_specs.h"
+#include "tube_table.h"
+
+// Smallest y and largest x and y of all tube centers
+struct tubesheet_extent {
+    float min_y;
+    float max_x;
+    float max_y;
+};
+
+tubesheet_extent extent_of(const tube_table &tubes);
+
+// The viewBox of the drawing: the extent plus a margin for the labels on the
+// left and top, rounded out to whole units
+struct svg_view_box {
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+svg_view_box view_box_of(const tubesheet_extent &extent);
+
+enum class svg_mode {
+    // A group with title, circle and number per tube
+    groups,
+    // The tube circle defined once in <defs> and placed with a <use> per
+    // tube; the tube numbers follow in a group per leg. The tube ids and
+    // labels are only in the index written by write_tube_index.
+    symbols,
+    // All tube outlines in one <path> of arcs and the numbers as in symbols
+    // mode, for sheets too big for an element per tube. Scripts find the
+    // tubes through the index written by write_tube_index.
+    paths
+};
+
+// CSS classes of the tube circles in place of the plain "tube", e.g. to
+// color the tubes of inspection plans
+struct tube_overlay {
+    // Rules for the classes, appended to the style sheet
+    std::string css;
+    // Every distinct class attribute; the first one is "tube"
+    std::vector<std::string> classes;
+    // Per tube index into classes
+    std::vector<std::uint32_t> class_of;
+
+    std::string_view class_of_tube(std::size_t i) const {
+        return classes[class_of[i]];
+    }
+};
+
+struct svg_options {
+    svg_mode mode = svg_mode::groups;
+    // In symbols mode, draws the whole cold leg as one transformed <use> of
+    // the hot leg if it is the point reflection of it. The cold leg tubes
+    // then have no elements of their own.
+    bool mirror_cl = false;
+    // In paths mode, leaves out the tube numbers
+    bool tube_numbers = true;
+    // In groups mode, an svg_stream_writer formats the tubes in chunks on
+    // this many threads. The output does not depend on it.
+    unsigned threads = 1;
+    // Classes for the tubes, drawn in the same pass. In symbols mode the
+    // cold leg is then never mirrored, in paths mode the tubes with a class
+    // are drawn again in a path per class.
+    const tube_overlay *overlay = nullptr;
+};
+
+// Checks whether every cold leg tube sits at the point reflection of the hot
+// leg tube with the same number, (offset_x - x, -y), and vice versa.
+bool cl_mirrors_hl(const tube_table &tubes, float &offset_x);
+
+// Pool bytes an svg_dom_writer takes for the drawing, a slight overestimate
+// meant for rapidxml::memory_pool::reserve
+std::size_t estimate_dom_pool_size(const tubesheet &sheet);
+
+// Writes the tubesheet drawing through an svg_stream_writer or an
+// svg_dom_writer, both produce the same document.
+template<class Writer>
+void write_tubesheet_svg(Writer &out, const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const svg_options &options = svg_options());
+
+// The groups mode drawing without overlay, with the places where overlays
+// change it: the end of the style sheet text and, per tube, the end of the
+// "tube" class of its circle. Overlays whose classes all start with "tube"
+// are then written by splicing their rules and classes into these bytes.
+struct tubesheet_base {
+    std::string bytes;
+    std::size_t style_end = 0;
+    std::vector<std::size_t> class_end;
+};
+
+tubesheet_base render_tubesheet_base(const tubesheet &sheet,
+        const tube_specs &specs, const tubesheet_extent &extent,
+        const number_format &numbers);
+
+// Writes the same bytes as write_tubesheet_svg in groups mode with the
+// overlay
+void write_tubesheet_variant(std::ostream &out, const tubesheet_base &base,
+        const tube_overlay &overlay);
+
+#endif
@@ -0,0 +1,211 @@
+#include "tubesheet_tiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "parallel.h"
+#include "svg_elements.h"
+#include "tube_grid.h"
+
+namespace {
+
+// Side of a raster cell in pixels
+const unsigned raster_pixels = 4;
+
+struct tile {
+    int zoom;
+    std::size_t x;
+    std::size_t y;
+};
+
+// Tiles are numbered level by level, row by row
+tile tile_at(std::size_t index) {
+    tile t { 0, 0, 0 };
+    std::size_t level_size = 1;
+    while (index >= level_size) {
+        index -= level_size;
+        level_size *= 4;
+        ++t.zoom;
+    }
+    std::size_t side = std::size_t(1) << t.zoom;
+    t.x = index % side;
+    t.y = index / side;
+    return t;
+}
+
+std::size_t tile_count(int max_zoom) {
+    return ((std::size_t(1) << 2 * (max_zoom + 1)) - 1) / 3;
+}
+
+std::string tile_directory(const std::string &directory, int zoom,
+        std::size_t x) {
+    return directory + "/" + std::to_string(zoom) + "/" + std::to_string(x);
+}
+
+// The cells of a raster_pixels grid over the tile that tubes touch, as one
+// rectangle per run of cells in a raster row
+std::string raster_path(const tube_table &tubes,
+        const std::vector<std::uint32_t> &found, const svg_view_box &box,
+        float radius, unsigned cells, number_cache &numbers) {
+    float cell = box.width / cells;
+    auto cell_of = [&](float offset) {
+        return std::clamp<long>(long(std::floor(offset / cell)), 0, cells - 1);
+    };
+    std::vector<bool> covered(cells * cells);
+    for (std::uint32_t i : found) {
+        long first_column = cell_of(tubes.x[i] - radius - box.x);
+        long last_column = cell_of(tubes.x[i] + radius - box.x);
+        long first_row = cell_of(tubes.y[i] - radius - box.y);
+        long last_row = cell_of(tubes.y[i] + radius - box.y);
+        for (long row = first_row; row <= last_row; ++row) {
+            for (long column = first_column; column <= last_column; ++column) {
+                covered[row * cells + column] = true;
+            }
+        }
+    }
+
+    std::string d;
+    for (unsigned row = 0; row < cells; ++row) {
+        for (unsigned column = 0; column < cells;) {
+            if (!covered[row * cells + column]) {
+                ++column;
+                continue;
+            }
+            unsigned first = column;
+            while (column < cells && covered[row * cells + column]) {
+                ++column;
+            }
+            float width = (column - first) * cell;
+            d += 'M';
+            d += numbers.text(box.x + first * cell);
+            d += ',';
+            d += numbers.text(box.y + row * cell);
+            d += 'h';
+            d += numbers.text(width);
+            d += 'v';
+            d += numbers.text(cell);
+            d += 'h';
+            d += numbers.text(-width);
+            d += 'z';
+        }
+    }
+    return d;
+}
+
+}
+
+tile_report write_tile_pyramid(const tubesheet &sheet, const tube_specs &specs,
+        const tubesheet_extent &extent, const tile_options &options) {
+    const tube_table &tubes = sheet.tubes;
+    float radius = specs.tube_od / 2;
+    svg_view_box whole = view_box_of(extent);
+    float side = std::max(whole.width, whole.height);
+    auto tube_pixels = [&](int zoom) {
+        return specs.tube_od * options.tile_pixels * float(1 << zoom) / side;
+    };
+
+    tile_report report { options.max_zoom, 0, 0, 0 };
+    if (report.max_zoom < 0) {
+        report.max_zoom = 0;
+        while (report.max_zoom < max_tile_zoom
+                && tube_pixels(report.max_zoom) < 2 * detail_pixels) {
+            ++report.max_zoom;
+        }
+    }
+    report.max_zoom = std::min(report.max_zoom, max_tile_zoom);
+
+    for (int zoom = 0; zoom <= report.max_zoom; ++zoom) {
+        for (std::size_t x = 0; x < std::size_t(1) << zoom; ++x) {
+            std::filesystem::create_directories(
+                    tile_directory(options.directory, zoom, x));
+        }
+    }
+
+    // A few tubes per cell at the pitch of a tubesheet
+    tube_grid grid(tubes, 2 * specs.tube_od);
+    std::atomic<std::size_t> written(0);
+    std::atomic<std::size_t> largest(0);
+    parallel_for(tile_count(report.max_zoom), options.threads,
+            [&](std::size_t index) {
+                tile t = tile_at(index);
+                float tile_side = side / float(1 << t.zoom);
+                svg_view_box box { whole.x + t.x * tile_side, whole.y
+                        + t.y * tile_side, tile_side, tile_side };
+
+                // Tubes that reach into the tile
+                std::vector<std::uint32_t> found;
+                grid.find(box.x - radius, box.y - radius,
+                        box.x + box.width + radius, box.y + box.height + radius,
+                        found);
+                if (found.empty()) {
+                    return;
+                }
+
+                std::string name = tile_directory(options.directory, t.zoom,
+                        t.x) + "/" + std::to_string(t.y) + ".svg";
+                std::ofstream file(name);
+                if (!file) {
+                    throw std::runtime_error("Can not write " + name);
+                }
+                svg_stream_writer out(file, options.numbers, 1 << 14);
+                out.start_element("svg");
+                out.attribute("height", options.tile_pixels);
+                out.attribute("version", "1.1");
+                out.attribute("viewBox", view_box_text(box, out.numbers()));
+                out.attribute("width", options.tile_pixels);
+                out.attribute("xmlns", "http://www.w3.org/2000/svg");
+
+                float pixels = tube_pixels(t.zoom);
+                number_cache numbers(options.numbers);
+                if (pixels < outline_pixels) {
+                    out.start_element("path");
+                    out.attribute("d", raster_path(tubes, found, box, radius,
+                            options.tile_pixels / raster_pixels, numbers));
+                    out.attribute("fill", "gray");
+                    out.end_element();
+                    add_center_lines(out, extent);
+                } else if (pixels < detail_pixels) {
+                    add_style(out, tubesheet_css);
+                    add_center_lines(out, extent);
+                    circle_path circles(numbers, radius);
+                    for (std::uint32_t i : found) {
+                        circles.add(tubes.x[i], tubes.y[i]);
+                    }
+                    out.start_element("path");
+                    out.attribute("class", "tube");
+                    out.attribute("d", circles.d);
+                    out.end_element();
+                } else {
+                    add_style(out, tubesheet_css);
+                    add_center_lines(out, extent);
+                    // Labels straddling the tile edge are drawn in both tiles
+                    svg_view_box clip { box.x - 0.5f, box.y - 0.5f,
+                            box.width + 1, box.height + 1 };
+                    add_labels(out, sheet, specs.calle_ancha, &clip);
+                    for (std::uint32_t i : found) {
+                        add_tube(out, tubes.x[i], tubes.y[i], radius,
+                                tubes.id(i), tubes.col[i], tubes.row[i]);
+                    }
+                }
+                out.end_element();
+                out.end_document();
+                if (!file) {
+                    throw std::runtime_error("Can not write " + name);
+                }
+
+                std::size_t bytes = file.tellp();
+                ++written;
+                std::size_t seen = largest;
+                while (bytes > seen && !largest.compare_exchange_weak(seen, bytes)) {
+                }
+            });
+
+    report.written = written;
+    report.empty = tile_count(report.max_zoom) - report.written;
+    report.largest_bytes = largest;
+    return report;
+}
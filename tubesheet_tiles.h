@@ -0,0 +1,49 @@
+#ifndef TUBESHEET_TILES_H
+#define TUBESHEET_TILES_H
+
+#include <cstddef>
+#include <string>
+#include "svg_writer.h"
+#include "tube_specs.h"
+#include "tube_table.h"
+#include "tubesheet_svg.h"
+
+// A z/x/y pyramid of square SVG tiles for viewers that pan and zoom. Level 0
+// is one tile over the viewBox of the whole drawing (square, grown to its
+// longer side), every level halves the tile side. What a tile shows depends
+// on how many pixels a tube gets in it:
+// - fewer than outline_pixels: the area covered by tubes as a coarse raster
+// - fewer than detail_pixels: the tube outlines as one path
+// - otherwise: groups like the full drawing, with numbers, titles and labels
+// so every tile stays within a few hundred elements.
+
+struct tile_options {
+    // Tiles are written to directory/z/x/y.svg
+    std::string directory = "tiles";
+    // Deepest level; negative picks the first one at which tubes are
+    // 2 * detail_pixels wide
+    int max_zoom = -1;
+    // Nominal width and height of a tile
+    unsigned tile_pixels = 256;
+    unsigned threads = 1;
+    number_format numbers;
+};
+
+const float outline_pixels = 6;
+const float detail_pixels = 24;
+// Past this a pyramid has millions of tiles
+const int max_tile_zoom = 12;
+
+struct tile_report {
+    int max_zoom;
+    std::size_t written;
+    // Tiles without tubes are not written, viewers show them blank
+    std::size_t empty;
+    std::size_t largest_bytes;
+};
+
+// Throws std::runtime_error if a tile can not be written.
+tile_report write_tile_pyramid(const tubesheet &sheet, const tube_specs &specs,
+        const tubesheet_extent &extent, const tile_options &options);
+
+#endif